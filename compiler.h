@@ -97,5 +97,17 @@
 #define MAYBE_ALIGN(x)
 #endif
 
+/* let the CPU know we're spinning on a shared location, to save power and
+ * leave the pipeline to the sibling thread.
+ */
+#ifndef cpu_relax
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define cpu_relax() __asm__ volatile("yield" ::: "memory")
+#else
+#define cpu_relax() __asm__ volatile("" ::: "memory")
+#endif
+#endif
 
 #endif /* _EBTREE_COMPILER_H */
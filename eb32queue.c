@@ -0,0 +1,151 @@
+/*
+ * Elastic Binary Trees - multi-producer submission queue for 32bit trees.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult eb32queue.h for more details about those functions */
+
+#include <stdlib.h>
+#include "eb32queue.h"
+
+/* Initializes queue <q> with room for at least <size> pending requests. The
+ * size is rounded up to the next power of two. Returns non-zero on success,
+ * or zero if memory could not be allocated.
+ */
+int eb32_queue_init(struct eb32_queue *q, unsigned int size)
+{
+	unsigned long slots, i;
+
+	for (slots = 2; slots < size; slots <<= 1)
+		;
+
+	q->slots = calloc(slots, sizeof(*q->slots));
+	q->batch = calloc(slots, sizeof(*q->batch));
+	if (!q->slots || !q->batch) {
+		eb32_queue_destroy(q);
+		return 0;
+	}
+
+	for (i = 0; i < slots; i++)
+		q->slots[i].seq = i;
+	q->mask = slots - 1;
+	q->head = 0;
+	q->tail = 0;
+	return 1;
+}
+
+/* Releases the storage used by queue <q>. Pending requests are lost. */
+void eb32_queue_destroy(struct eb32_queue *q)
+{
+	free(q->slots);
+	free(q->batch);
+	q->slots = q->batch = NULL;
+}
+
+/* Groups requests per node, preserving their arrival order which is stored
+ * in <seq> while they are in the batch.
+ */
+static int eb32_queue_cmp_node(const void *a, const void *b)
+{
+	const struct eb32_qslot *ra = a, *rb = b;
+
+	if (ra->node != rb->node)
+		return ra->node < rb->node ? -1 : 1;
+	return ra->seq < rb->seq ? -1 : ra->seq > rb->seq;
+}
+
+/* Sorts insertions by key. Equal keys are kept in arrival order so that they
+ * appear in the tree's duplicates in the order they were submitted.
+ */
+static int eb32_queue_cmp_key(const void *a, const void *b)
+{
+	const struct eb32_qslot *ra = a, *rb = b;
+
+	if (ra->key != rb->key)
+		return ra->key < rb->key ? -1 : 1;
+	return ra->seq < rb->seq ? -1 : ra->seq > rb->seq;
+}
+
+/* Drains up to <max> pending requests from queue <q> and applies them to tree
+ * <root>. <max> may be zero to drain as many requests as the queue may hold.
+ * Only the thread owning the tree may call this function. If the tree only
+ * accepts unique keys, nodes which cannot be inserted because their key is
+ * already there are left out of the tree and passed to <refused> with <arg>
+ * if <refused> is not NULL. Returns the number of requests which were
+ * consumed, including those which were coalesced.
+ */
+unsigned int eb32_queue_apply(struct eb32_queue *q, struct eb_root *root, unsigned int max,
+                              void (*refused)(struct eb32_node *node, void *arg), void *arg)
+{
+	struct eb32_qslot *slot, *req;
+	unsigned long pos;
+	unsigned int nb, ins, i, j;
+
+	if (!max || max > q->mask + 1)
+		max = q->mask + 1;
+
+	/* 1) move the ready requests to the batch so that the slots are
+	 * released to producers as soon as possible.
+	 */
+	pos = q->tail;
+	for (nb = 0; nb < max; nb++, pos++) {
+		slot = &q->slots[pos & q->mask];
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+			break;
+		q->batch[nb] = *slot;
+		q->batch[nb].seq = nb;
+		__atomic_store_n(&slot->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+	}
+	q->tail = pos;
+
+	if (!nb)
+		return 0;
+
+	/* 2) only the last request for each node matters. Any node mentioned
+	 * in the batch is first unlinked (it's a no-op if it was not in the
+	 * tree), and those which must be (re-)inserted are moved to the
+	 * beginning of the batch. We can safely overwrite the batch while
+	 * walking over it since we never write past the current group.
+	 */
+	qsort(q->batch, nb, sizeof(*q->batch), eb32_queue_cmp_node);
+	ins = 0;
+	for (i = 0; i < nb; i = j) {
+		for (j = i + 1; j < nb && q->batch[j].node == q->batch[i].node; j++)
+			;
+		req = &q->batch[j - 1];
+		__eb32_delete(req->node);
+		if (req->op == EB32_Q_INSERT)
+			q->batch[ins++] = *req;
+	}
+
+	/* 3) insert in ascending key order */
+	qsort(q->batch, ins, sizeof(*q->batch), eb32_queue_cmp_key);
+	for (i = 0; i < ins; i++) {
+		req = &q->batch[i];
+		req->node->key = req->key;
+		if (__eb32_insert(root, req->node) != req->node && refused)
+			refused(req->node, arg);
+	}
+	return nb;
+}
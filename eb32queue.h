@@ -0,0 +1,136 @@
+/*
+ * Elastic Binary Trees - multi-producer submission queue for 32bit trees.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* A tree is only ever modified by its owner thread (typically the event loop
+ * for a timer tree). Other threads which want to arm or disarm a timer do not
+ * touch the tree, they post an insert or delete request into a bounded
+ * lock-free ring attached to the tree. The owner then periodically drains the
+ * ring and applies all pending requests at once :
+ *   - requests are coalesced per node, only the last one counts ;
+ *   - deletions are performed first ;
+ *   - insertions are sorted by key and performed in ascending order, so that
+ *     consecutive insertions walk mostly the same, already cached, path.
+ *
+ * Since a node may still be linked into the tree when a producer re-arms it,
+ * the producer must never write into the node itself. The key is carried in
+ * the request instead, and only assigned by the owner thread right before the
+ * insertion. A node which has been submitted must not be released until the
+ * owner has applied the request. If the tree only accepts unique keys, an
+ * insertion may be refused, in which case the owner is told about the node
+ * which remains out of the tree.
+ */
+
+#ifndef _EB32QUEUE_H
+#define _EB32QUEUE_H
+
+#include "eb32tree.h"
+
+/* Request types carried in eb32_qslot->op */
+#define EB32_Q_INSERT	0
+#define EB32_Q_DELETE	1
+
+/* One request slot. <seq> implements the ring's sequencing : a slot at
+ * position <pos> is free for producers when seq == pos, and ready for the
+ * consumer when seq == pos + 1.
+ */
+struct eb32_qslot {
+	unsigned long seq;
+	struct eb32_node *node;
+	u32 key;
+	unsigned int op;
+};
+
+/* The queue itself. Producers only write <head>, the consumer only writes
+ * <tail>, and both read <mask> and <slots> on each request, so these three
+ * groups are kept on separate cache lines.
+ */
+struct eb32_queue {
+	unsigned long mask ALIGNED(64);  /* number of slots - 1 */
+	struct eb32_qslot *slots;        /* <mask>+1 slots */
+	unsigned long head ALIGNED(64);  /* next position to be reserved by producers */
+	unsigned long tail ALIGNED(64);  /* next position to be consumed by the owner */
+	struct eb32_qslot *batch;        /* scratch area used by the owner to sort */
+};
+
+/* The following functions are not inlined. They are declared in eb32queue.c */
+int eb32_queue_init(struct eb32_queue *q, unsigned int size);
+void eb32_queue_destroy(struct eb32_queue *q);
+unsigned int eb32_queue_apply(struct eb32_queue *q, struct eb_root *root, unsigned int max,
+                              void (*refused)(struct eb32_node *node, void *arg), void *arg);
+
+/* Posts request <op> for node <node> and key <key> into queue <q>. This may be
+ * called from any thread. Returns non-zero on success, or zero if the queue is
+ * full, in which case the caller may retry later. It never blocks.
+ */
+static inline int eb32_queue_push(struct eb32_queue *q, struct eb32_node *node, u32 key, unsigned int op)
+{
+	struct eb32_qslot *slot;
+	unsigned long pos, seq;
+	long dif;
+
+	pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	while (1) {
+		slot = &q->slots[pos & q->mask];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		dif = (long)(seq - pos);
+		if (dif == 0) {
+			/* the slot is free, try to reserve it */
+			if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, 1,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+			/* <pos> was updated by the failed CAS */
+		}
+		else if (dif < 0)
+			return 0; /* the consumer is one lap late: full */
+		else
+			pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	}
+
+	slot->node = node;
+	slot->key  = key;
+	slot->op   = op;
+	/* publish the request to the consumer */
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/* Requests that node <node> be inserted with key <key> (or moved to this key
+ * if it is already in the tree). See eb32_queue_push() for the return value.
+ */
+static inline int eb32_queue_insert(struct eb32_queue *q, struct eb32_node *node, u32 key)
+{
+	return eb32_queue_push(q, node, key, EB32_Q_INSERT);
+}
+
+/* Requests that node <node> be removed from the tree if it is there. See
+ * eb32_queue_push() for the return value.
+ */
+static inline int eb32_queue_delete(struct eb32_queue *q, struct eb32_node *node)
+{
+	return eb32_queue_push(q, node, 0, EB32_Q_DELETE);
+}
+
+#endif /* _EB32QUEUE_H */
@@ -48,6 +48,11 @@ struct eb32_node *eb32i_lookup(struct eb_root *root, s32 x)
 	return __eb32i_lookup(root, x);
 }
 
+struct eb32_node *eb32_lookup_branchless(struct eb_root *root, u32 x)
+{
+	return __eb32_lookup_branchless(root, x);
+}
+
 /*
  * Find the last occurrence of the highest key in the tree <root>, which is
  * equal to or less than <x>. NULL is returned is no key matches.
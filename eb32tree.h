@@ -119,6 +119,7 @@ static inline void eb32_delete(struct eb32_node *eb32)
  */
 struct eb32_node *eb32_lookup(struct eb_root *root, u32 x);
 struct eb32_node *eb32i_lookup(struct eb_root *root, s32 x);
+struct eb32_node *eb32_lookup_branchless(struct eb_root *root, u32 x);
 struct eb32_node *eb32_lookup_le(struct eb_root *root, u32 x);
 struct eb32_node *eb32_lookup_ge(struct eb_root *root, u32 x);
 struct eb32_node *eb32_insert(struct eb_root *root, struct eb32_node *new);
@@ -186,6 +187,71 @@ static forceinline struct eb32_node *__eb32_lookup(struct eb_root *root, u32 x)
 	}
 }
 
+/* Take one step down from <troot> towards key <x> without any conditional
+ * branch : the next branch is always loaded and is only selected using a mask
+ * if <troot> is neither a leaf nor a dup tree. Otherwise <troot> is returned
+ * unchanged, so that it is harmless to call it again once the bottom is
+ * reached. Note that the node part of a leaf may be unused, in which case we
+ * load random pointers, but they are never dereferenced.
+ */
+static forceinline eb_troot_t *__eb32_step_branchless(eb_troot_t *troot, u32 x)
+{
+	struct eb32_node *node;
+	eb_troot_t *next;
+	unsigned long keep;
+
+	node = container_of((struct eb_root *)((unsigned long)troot & ~1UL),
+			    struct eb32_node, node.branches);
+	next = node->node.branches.b[(x >> (node->node.bit & 31)) & EB_NODE_BRANCH_MASK];
+	keep = -(unsigned long)((eb_gettag(troot) == EB_LEAF) | (node->node.bit < 0));
+	return (eb_troot_t *)(((unsigned long)troot & keep) | ((unsigned long)next & ~keep));
+}
+
+/*
+ * Find the first occurence of a key in the tree <root>. If none can be
+ * found, return NULL. Contrary to __eb32_lookup(), the key is not checked
+ * on the way down, only the branches are followed, and three out of four
+ * levels are walked down without any conditional branch, so that random keys
+ * do not cause mispredictions at every level. The key is verified once on the
+ * leaf or the dup tree we end up on. This is faster with random keys on trees
+ * which fit in the cache. It is slower on larger trees and on skewed or
+ * ordered keys, where the predicted branches let the CPU fetch the next nodes
+ * ahead, and when most lookups would miss early.
+ */
+static forceinline struct eb32_node *__eb32_lookup_branchless(struct eb_root *root, u32 x)
+{
+	struct eb32_node *node;
+	eb_troot_t *troot;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		troot = __eb32_step_branchless(troot, x);
+		troot = __eb32_step_branchless(troot, x);
+		troot = __eb32_step_branchless(troot, x);
+		node = container_of((struct eb_root *)((unsigned long)troot & ~1UL),
+				    struct eb32_node, node.branches);
+		if (eb_gettag(troot) == EB_LEAF || node->node.bit < 0)
+			break;
+		troot = node->node.branches.b[(x >> node->node.bit) & EB_NODE_BRANCH_MASK];
+	}
+
+	if (node->key != x)
+		return NULL;
+
+	if (eb_gettag(troot) == EB_NODE) {
+		/* dup tree, return the first entry */
+		troot = node->node.branches.b[EB_LEFT];
+		while (eb_gettag(troot) != EB_LEAF)
+			troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+		node = container_of(eb_untag(troot, EB_LEAF),
+				    struct eb32_node, node.branches);
+	}
+	return node;
+}
+
 /*
  * Find the first occurence of a signed key in the tree <root>. If none can
  * be found, return NULL.
@@ -48,6 +48,11 @@ struct eb64_node *eb64i_lookup(struct eb_root *root, s64 x)
 	return __eb64i_lookup(root, x);
 }
 
+struct eb64_node *eb64_lookup_branchless(struct eb_root *root, u64 x)
+{
+	return __eb64_lookup_branchless(root, x);
+}
+
 /*
  * Find the last occurrence of the highest key in the tree <root>, which is
  * equal to or less than <x>. NULL is returned is no key matches.
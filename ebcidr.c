@@ -0,0 +1,452 @@
+/*
+ * Elastic Binary Trees - aggregation of IPv4 and IPv6 network lists.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebcidr.h for more details about those functions */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "ebcidr.h"
+
+/* An IPv6 network queued by ebcidr_add_text(). IPv4 networks are queued as
+ * 40-bit integers made of the address followed by the prefix length, so that
+ * they sort in the same order as ebcidr_cmp_net6() would sort them.
+ */
+struct ebcidr_net6 {
+	unsigned char addr[16];
+	unsigned char pfx;
+};
+
+/* Initializes the empty set <set>. Returns non-zero on success or zero if the
+ * pools could not be created.
+ */
+int ebcidr_init(struct ebcidr *set)
+{
+	set->net4 = (struct eb_root)EB_ROOT_UNIQUE;
+	set->net6 = (struct eb_root)EB_ROOT_UNIQUE;
+	set->nb4 = set->nb6 = 0;
+	memset(&set->queue4, 0, sizeof(set->queue4));
+	memset(&set->queue6, 0, sizeof(set->queue6));
+
+	if (!ebmb_pool_init(&set->pool4, 4))
+		return 0;
+	if (!ebmb_pool_init(&set->pool6, 16)) {
+		eb_pool_destroy(&set->pool4);
+		return 0;
+	}
+	return 1;
+}
+
+/* Releases all the networks of set <set> at once, including queued ones */
+void ebcidr_destroy(struct ebcidr *set)
+{
+	free(set->queue4.items);
+	free(set->queue6.items);
+	memset(&set->queue4, 0, sizeof(set->queue4));
+	memset(&set->queue6, 0, sizeof(set->queue6));
+	eb_pool_flush(&set->pool4);
+	eb_pool_flush(&set->pool6);
+	eb_pool_destroy(&set->pool4);
+	eb_pool_destroy(&set->pool6);
+	set->net4 = (struct eb_root)EB_ROOT_UNIQUE;
+	set->net6 = (struct eb_root)EB_ROOT_UNIQUE;
+	set->nb4 = set->nb6 = 0;
+}
+
+/* Adds network <addr>/<pfx> of <len> bytes to tree <root> whose nodes come
+ * from <pool> and whose number of networks is in <nb>. <addr> must be clean
+ * past <pfx> bits and is modified. This is the algorithm of the historical
+ * examples/reduce.c, without the recursion. Returns zero if memory is
+ * exhausted, otherwise non-zero.
+ */
+static int ebcidr_insert(struct eb_root *root, struct eb_pool *pool, unsigned long *nb,
+			 unsigned char *addr, unsigned int len, unsigned int pfx)
+{
+	struct ebmb_node *node, *next;
+	unsigned char bit;
+
+	while (1) {
+		/* 1) nothing to do if the network is already covered. The
+		 * tree is reduced, so a covering network is never found along
+		 * with a more specific one.
+		 */
+		node = __ebmb_lookup_longest(root, addr);
+		if (node && node->node.pfx <= pfx)
+			return 1;
+
+		if (!pfx)
+			break;
+
+		/* 2) look for the other half of the network one bit larger,
+		 * in which case both are replaced with the larger one.
+		 */
+		bit = 0x80 >> ((pfx - 1) & 7);
+		addr[(pfx - 1) >> 3] ^= bit;
+		node = __ebmb_lookup_prefix(root, addr, pfx);
+		addr[(pfx - 1) >> 3] ^= bit;
+		if (!node)
+			break;
+
+		addr[(pfx - 1) >> 3] &= ~bit;
+		__ebmb_delete(node);
+		eb_pool_free(pool, node);
+		(*nb)--;
+		pfx--;
+	}
+
+	node = eb_pool_alloc(pool);
+	if (!node)
+		return 0;
+
+	memcpy(node->key, addr, len);
+	node->node.pfx = pfx;
+	__ebmb_insert_prefix(root, node, len);
+	(*nb)++;
+
+	/* 3) the networks covered by the new one all immediately follow it */
+	next = ebmb_next(node);
+	while (next && !check_bits(next->key, addr, 0, pfx)) {
+		node = next;
+		next = ebmb_next(node);
+		__ebmb_delete(node);
+		eb_pool_free(pool, node);
+		(*nb)--;
+	}
+	return 1;
+}
+
+/* Adds network <addr>/<pfx> to set <set>. <addr> is in network byte order and
+ * is <len> bytes long, 4 for IPv4 or 16 for IPv6. The bits past <pfx> are
+ * ignored. Returns zero if memory is exhausted or <len> is not supported,
+ * otherwise non-zero.
+ */
+int ebcidr_add(struct ebcidr *set, const void *addr, unsigned int len, unsigned int pfx)
+{
+	unsigned char net[16];
+
+	if (len != 4 && len != 16)
+		return 0;
+
+	if (pfx > len * 8)
+		pfx = len * 8;
+
+	/* clear the host bits */
+	memcpy(net, addr, len);
+	if (pfx & 7)
+		net[pfx >> 3] &= 0xff00 >> (pfx & 7);
+	memset(net + ((pfx + 7) >> 3), 0, len - ((pfx + 7) >> 3));
+
+	if (len == 4)
+		return ebcidr_insert(&set->net4, &set->pool4, &set->nb4, net, 4, pfx);
+	return ebcidr_insert(&set->net6, &set->pool6, &set->nb6, net, 16, pfx);
+}
+
+/* Parses the decimal number between <str> and <end> into <val>. Returns
+ * non-zero if it has 1 to 3 digits and does not exceed <max>.
+ */
+static int ebcidr_parse_num(const char *str, const char *end, unsigned int max, unsigned int *val)
+{
+	if (str == end || end - str > 3)
+		return 0;
+
+	for (*val = 0; str < end; str++) {
+		if ((unsigned char)(*str - '0') > 9)
+			return 0;
+		*val = *val * 10 + *str - '0';
+	}
+	return *val <= max;
+}
+
+/* Parses the dotted IPv4 address between <str> and <end> into <addr>. Returns
+ * non-zero on success.
+ */
+static int ebcidr_parse_ipv4(const char *str, const char *end, unsigned char *addr)
+{
+	const char *dot;
+	unsigned int i, val;
+
+	for (i = 0; i < 4; i++) {
+		for (dot = str; dot < end && *dot != '.'; dot++)
+			;
+		if ((dot < end) != (i < 3) || !ebcidr_parse_num(str, dot, 255, &val))
+			return 0;
+		addr[i] = val;
+		str = dot + 1;
+	}
+	return 1;
+}
+
+/* Parses the network between <str> and <end>, in the form <addr>[/<mask>],
+ * where <addr> is an IPv4 or IPv6 address, and <mask> either a prefix length
+ * or a dotted IPv4 netmask, whose leading ones are counted. Without a mask, a
+ * host address is assumed. The address is stored into <addr> which must have
+ * room for 16 bytes, and the prefix length into <pfx>. Returns the address
+ * length, 4 or 16, or zero if the network is invalid.
+ */
+unsigned int ebcidr_parse(const char *str, const char *end, unsigned char *addr, unsigned int *pfx)
+{
+	char buf[INET6_ADDRSTRLEN];
+	const char *slash, *p;
+	unsigned char mask[4];
+	unsigned int len, m;
+
+	slash = memchr(str, '/', end - str);
+	if (!slash)
+		slash = end;
+
+	len = 4;
+	for (p = str; p < slash; p++) {
+		if (*p == ':') {
+			len = 16;
+			break;
+		}
+	}
+
+	if (len == 4) {
+		if (!ebcidr_parse_ipv4(str, slash, addr))
+			return 0;
+	}
+	else {
+		if (slash - str >= (int)sizeof(buf))
+			return 0;
+		memcpy(buf, str, slash - str);
+		buf[slash - str] = 0;
+		if (inet_pton(AF_INET6, buf, addr) != 1)
+			return 0;
+	}
+
+	*pfx = len * 8;
+	if (slash == end)
+		return len;
+
+	slash++;
+	if (ebcidr_parse_num(slash, end, len * 8, pfx))
+		return len;
+
+	if (len != 4 || !ebcidr_parse_ipv4(slash, end, mask))
+		return 0;
+
+	m = (mask[0] << 24) | (mask[1] << 16) | (mask[2] << 8) | mask[3];
+	*pfx = ~m ? 32 - flsnz(~m) : 32;
+	return len;
+}
+
+/* Sorts IPv6 networks per address, then size, the largest first */
+static int ebcidr_cmp_net6(const void *a, const void *b)
+{
+	const struct ebcidr_net6 *na = a, *nb = b;
+	int ret;
+
+	ret = memcmp(na->addr, nb->addr, 16);
+	if (ret)
+		return ret;
+	return na->pfx < nb->pfx ? -1 : na->pfx > nb->pfx;
+}
+
+static int ebcidr_cmp_net4(const void *a, const void *b)
+{
+	unsigned long long na = *(const unsigned long long *)a, nb = *(const unsigned long long *)b;
+
+	return na < nb ? -1 : na > nb;
+}
+
+/* Sorts the <nb> IPv4 networks of <nets>, which are 40-bit integers, with a
+ * radix sort, one byte at a time from the lowest one, which is several times
+ * faster than qsort() on millions of networks. Bytes which are the same for
+ * all networks are skipped.
+ */
+static void ebcidr_sort4(unsigned long long *nets, unsigned long nb)
+{
+	unsigned long long *src, *dst, *tmp;
+	unsigned long count[256], pos, i;
+	unsigned int shift, b;
+
+	if (nb < 2)
+		return;
+
+	tmp = malloc(nb * sizeof(*nets));
+	if (!tmp) {
+		qsort(nets, nb, sizeof(*nets), ebcidr_cmp_net4);
+		return;
+	}
+
+	src = nets;
+	dst = tmp;
+	for (shift = 0; shift < 40; shift += 8) {
+		memset(count, 0, sizeof(count));
+		for (i = 0; i < nb; i++)
+			count[(src[i] >> shift) & 255]++;
+
+		if (count[(src[0] >> shift) & 255] == nb)
+			continue;
+
+		for (pos = b = 0; b < 256; b++) {
+			i = count[b];
+			count[b] = pos;
+			pos += i;
+		}
+
+		for (i = 0; i < nb; i++)
+			dst[count[(src[i] >> shift) & 255]++] = src[i];
+
+		tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if (src != nets) {
+		memcpy(nets, src, nb * sizeof(*nets));
+		free(src);
+	}
+	else
+		free(dst);
+}
+
+/* Adds all the networks queued by ebcidr_add_text() to set <set> in ascending
+ * order. Consecutive insertions thus walk mostly the same, already cached,
+ * path, nodes are allocated in key order, and a network is always seen before
+ * those it covers, which are then immediately dropped. The queues are
+ * released. Returns zero if memory was exhausted, in which case some networks
+ * were lost, otherwise non-zero.
+ */
+int ebcidr_flush(struct ebcidr *set)
+{
+	unsigned long long *net4 = set->queue4.items;
+	struct ebcidr_net6 *net6 = set->queue6.items;
+	unsigned char addr[4];
+	unsigned long i;
+	int ret = 1;
+
+	ebcidr_sort4(net4, set->queue4.nb);
+	for (i = 0; i < set->queue4.nb; i++) {
+		addr[0] = net4[i] >> 32;
+		addr[1] = net4[i] >> 24;
+		addr[2] = net4[i] >> 16;
+		addr[3] = net4[i] >> 8;
+		if (!ebcidr_add(set, addr, 4, net4[i] & 255))
+			ret = 0;
+	}
+
+	if (set->queue6.nb > 1)
+		qsort(net6, set->queue6.nb, sizeof(*net6), ebcidr_cmp_net6);
+	for (i = 0; i < set->queue6.nb; i++)
+		if (!ebcidr_add(set, net6[i].addr, 16, net6[i].pfx))
+			ret = 0;
+
+	free(set->queue4.items);
+	free(set->queue6.items);
+	memset(&set->queue4, 0, sizeof(set->queue4));
+	memset(&set->queue6, 0, sizeof(set->queue6));
+	return ret;
+}
+
+/* Returns a free entry of <size> bytes at the end of queue <q> of set <set>,
+ * growing the queue as needed. All queues are flushed when it cannot grow
+ * anymore. Returns NULL if memory is exhausted.
+ */
+static void *ebcidr_queue(struct ebcidr *set, struct ebcidr_queue *q, unsigned int size)
+{
+	unsigned long max;
+	void *items;
+
+	if (q->nb == q->max) {
+		max = q->max ? q->max * 2 : 1024;
+		items = NULL;
+		if (max <= EBCIDR_MAX_PENDING)
+			items = realloc(q->items, max * size);
+		if (items) {
+			q->items = items;
+			q->max = max;
+		}
+		else if (!ebcidr_flush(set) || !(q->items = malloc(1024 * size)))
+			return NULL;
+		else
+			q->max = 1024;
+	}
+	return (char *)q->items + q->nb++ * size;
+}
+
+/* Queues into set <set> the networks listed in the <size> bytes of text at
+ * <buf>, one per line, as accepted by ebcidr_parse(). Leading blanks are
+ * skipped, empty lines and lines starting with '#' are ignored, and anything
+ * after the network (blanks, '#', ';' or ',') is ignored as well. <buf> does
+ * not need to be zero-terminated, so it may directly be a mapped file. The
+ * networks are only added to the set by ebcidr_flush(), so that they can be
+ * sorted first, which is several times faster than adding them in random
+ * order to a large set. The number of invalid lines is added to <bad>.
+ * Returns the number of networks queued, which is lower than the number of
+ * valid lines if memory is exhausted.
+ */
+unsigned long ebcidr_add_text(struct ebcidr *set, const char *buf, unsigned long size, unsigned long *bad)
+{
+	const char *end = buf + size;
+	const char *tok;
+	unsigned long long *net4;
+	struct ebcidr_net6 *net6;
+	unsigned char addr[16];
+	unsigned long queued = 0;
+	unsigned int len, pfx;
+
+	while (buf < end) {
+		while (buf < end && (*buf == ' ' || *buf == '\t' || *buf == '\r'))
+			buf++;
+
+		for (tok = buf; buf < end; buf++) {
+			if (*buf == '\n' || *buf == ' ' || *buf == '\t' || *buf == '\r' ||
+			    *buf == '#' || *buf == ';' || *buf == ',')
+				break;
+		}
+
+		if (buf > tok) {
+			len = ebcidr_parse(tok, buf, addr, &pfx);
+			if (!len)
+				(*bad)++;
+			else if (len == 4) {
+				net4 = ebcidr_queue(set, &set->queue4, sizeof(*net4));
+				if (net4) {
+					*net4 = ((unsigned long long)addr[0] << 32) | ((unsigned int)addr[1] << 24) |
+						(addr[2] << 16) | (addr[3] << 8) | pfx;
+					queued++;
+				}
+			}
+			else {
+				net6 = ebcidr_queue(set, &set->queue6, sizeof(*net6));
+				if (net6) {
+					memcpy(net6->addr, addr, 16);
+					net6->pfx = pfx;
+					queued++;
+				}
+			}
+		}
+
+		/* skip the rest of the line */
+		tok = memchr(buf, '\n', end - buf);
+		buf = tok ? tok + 1 : end;
+	}
+	return queued;
+}
@@ -0,0 +1,87 @@
+/*
+ * Elastic Binary Trees - aggregation of IPv4 and IPv6 network lists.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* An ebcidr set holds the smallest list of networks covering all the networks
+ * which were added to it. It is always kept reduced while networks are added :
+ *   - a network covered by another one is ignored ;
+ *   - a network covering other ones replaces them ;
+ *   - two adjacent networks of the same size forming a larger one are merged,
+ *     and so on with the resulting network.
+ *
+ * IPv4 and IPv6 networks are stored in two ebmb prefix trees, with 4 and 16
+ * bytes keys in network byte order, which may be walked with ebmb_first() and
+ * ebmb_next() to retrieve the networks in ascending order. Each node's key is
+ * the network address and node.pfx its prefix length. Nodes come from a pool
+ * per family, so that sets of millions of networks neither pay a malloc()
+ * per network nor fragment the heap. A set may only be used by one thread at
+ * a time.
+ *
+ * Adding networks one at a time to a large set is slow because each of them
+ * walks down the trees several times in random places. Networks read from
+ * text are thus only queued, and are added in ascending order once the text
+ * is fully loaded by ebcidr_flush(). This requires 8 bytes per queued IPv4
+ * network and 17 bytes per queued IPv6 network.
+ */
+
+#ifndef _EBCIDR_H
+#define _EBCIDR_H
+
+#include "ebmbtree.h"
+#include "ebpool.h"
+
+/* Max number of networks queued per family by ebcidr_add_text(). The queues
+ * are flushed when one of them is full.
+ */
+#define EBCIDR_MAX_PENDING	(1UL << 26)
+
+/* Networks queued by ebcidr_add_text() */
+struct ebcidr_queue {
+	void *items;                     /* queued networks */
+	unsigned long nb;                /* number of networks in <items> */
+	unsigned long max;               /* room in <items> */
+};
+
+/* A set of networks */
+struct ebcidr {
+	struct eb_root net4;             /* IPv4 networks, 4 bytes keys */
+	struct eb_root net6;             /* IPv6 networks, 16 bytes keys */
+	struct eb_pool pool4;            /* nodes for net4 */
+	struct eb_pool pool6;            /* nodes for net6 */
+	unsigned long nb4;               /* number of networks in net4 */
+	unsigned long nb6;               /* number of networks in net6 */
+	struct ebcidr_queue queue4;      /* IPv4 networks not added yet */
+	struct ebcidr_queue queue6;      /* IPv6 networks not added yet */
+};
+
+/* The following functions are not inlined. They are declared in ebcidr.c. */
+int ebcidr_init(struct ebcidr *set);
+void ebcidr_destroy(struct ebcidr *set);
+int ebcidr_add(struct ebcidr *set, const void *addr, unsigned int len, unsigned int pfx);
+unsigned int ebcidr_parse(const char *str, const char *end, unsigned char *addr, unsigned int *pfx);
+unsigned long ebcidr_add_text(struct ebcidr *set, const char *buf, unsigned long size, unsigned long *bad);
+int ebcidr_flush(struct ebcidr *set);
+
+#endif /* _EBCIDR_H */
@@ -0,0 +1,233 @@
+/*
+ * Elastic Binary Trees - key comparison kernels with runtime CPU dispatch.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* These functions find the first difference between two keys. They are used
+ * by the tree code instead of the inlined comparisons when it is built with
+ * EB_CPU_DISPATCH, so that a single binary may use the best kernel available
+ * on the CPU it runs on. On x86 with GNU ifunc support, the kernel is chosen
+ * once by the dynamic linker (or at startup for static binaries) and the call
+ * is then direct, without any per-call test. Elsewhere the generic kernels
+ * are used.
+ */
+
+#include <string.h>
+#include "ebtree.h"
+
+/* Smallest page size we may run on */
+#define EB_CMP_PAGE_SIZE	4096
+
+#if defined(__x86_64__) && defined(__ELF__) && defined(__GNUC__) && !defined(EB_NO_IFUNC)
+#define EB_CMP_IFUNC
+#include <immintrin.h>
+#endif
+
+/* Returns non-zero if <size> bytes may be read at <p> without crossing a page */
+static inline int eb_cmp_in_page(const unsigned char *p, unsigned int size)
+{
+	return ((unsigned long)p & (EB_CMP_PAGE_SIZE - 1)) <= EB_CMP_PAGE_SIZE - size;
+}
+
+/* Returns the position of the first byte which differs in the <len> bytes
+ * at <a> and <b>, or <len> if they are equal. Compares one machine word at
+ * a time.
+ */
+static unsigned int eb_memdiff_generic(const unsigned char *a, const unsigned char *b, unsigned int len)
+{
+	unsigned long wa, wb;
+	unsigned int pos = 0;
+
+	for (; pos + sizeof(wa) <= len; pos += sizeof(wa)) {
+		memcpy(&wa, a + pos, sizeof(wa));
+		memcpy(&wb, b + pos, sizeof(wb));
+		if (wa != wb)
+			break;
+	}
+	while (pos < len && a[pos] == b[pos])
+		pos++;
+	return pos;
+}
+
+/* Returns the position of the first byte which differs between strings <a>
+ * and <b>, or of their trailing zero if they are equal. Compares one machine
+ * word at a time when it does not cross a page boundary.
+ */
+static unsigned int eb_strdiff_generic(const unsigned char *a, const unsigned char *b)
+{
+	const unsigned long lo7 = ~0UL / 0xFF * 0x7F;
+	unsigned long wa, wb, x, m;
+	unsigned int pos = 0;
+
+	while (1) {
+		if (eb_cmp_in_page(a + pos, sizeof(wa)) && eb_cmp_in_page(b + pos, sizeof(wb))) {
+			memcpy(&wa, a + pos, sizeof(wa));
+			memcpy(&wb, b + pos, sizeof(wb));
+			/* any different byte, or any zero byte in <wb> ? */
+			x = wa ^ wb;
+			m = ((x & lo7) + lo7) | x;
+			m |= ~(((wb & lo7) + lo7) | wb);
+			if (!(m & ~lo7)) {
+				pos += sizeof(wa);
+				continue;
+			}
+		}
+		if (a[pos] != b[pos] || !b[pos])
+			return pos;
+		pos++;
+	}
+}
+
+#ifdef EB_CMP_IFUNC
+
+/* AVX2 version of eb_memdiff_generic() */
+__attribute__((target("avx2")))
+static unsigned int eb_memdiff_avx2(const unsigned char *a, const unsigned char *b, unsigned int len)
+{
+	unsigned int pos, m;
+
+	for (pos = 0; pos + 32 <= len; pos += 32) {
+		m = ~(unsigned int)_mm256_movemask_epi8(
+			_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + pos)),
+					  _mm256_loadu_si256((const __m256i *)(b + pos))));
+		if (m)
+			return pos + __builtin_ctz(m);
+	}
+	return pos + eb_memdiff_generic(a + pos, b + pos, len - pos);
+}
+
+/* SSE4.2 version of eb_strdiff_generic(). PCMPISTRI reports the first byte
+ * which differs, including where only one string ends, in one instruction
+ * per 16 bytes. When both strings end at the same place, it reports nothing
+ * but sets ZF, and the zero is then located with a regular compare.
+ */
+__attribute__((target("sse4.2")))
+static unsigned int eb_strdiff_sse42(const unsigned char *a, const unsigned char *b)
+{
+	const int mode = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_EACH |
+	                 _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT;
+	unsigned int pos = 0;
+	__m128i va, vb;
+	int idx;
+
+	while (1) {
+		if (eb_cmp_in_page(a + pos, 16) && eb_cmp_in_page(b + pos, 16)) {
+			va = _mm_loadu_si128((const __m128i *)(a + pos));
+			vb = _mm_loadu_si128((const __m128i *)(b + pos));
+			idx = _mm_cmpistri(va, vb, mode);
+			if (idx < 16)
+				return pos + idx;
+			if (_mm_cmpistrz(va, vb, mode))
+				return pos + __builtin_ctz(_mm_movemask_epi8(
+					_mm_cmpeq_epi8(vb, _mm_setzero_si128())));
+			pos += 16;
+			continue;
+		}
+		if (a[pos] != b[pos] || !b[pos])
+			return pos;
+		pos++;
+	}
+}
+
+/* AVX2 version of eb_strdiff_generic() */
+__attribute__((target("avx2")))
+static unsigned int eb_strdiff_avx2(const unsigned char *a, const unsigned char *b)
+{
+	unsigned int pos = 0, m;
+	__m256i va, vb;
+
+	while (1) {
+		if (eb_cmp_in_page(a + pos, 32) && eb_cmp_in_page(b + pos, 32)) {
+			va = _mm256_loadu_si256((const __m256i *)(a + pos));
+			vb = _mm256_loadu_si256((const __m256i *)(b + pos));
+			m = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+			m |= _mm256_movemask_epi8(_mm256_cmpeq_epi8(vb, _mm256_setzero_si256()));
+			if (m)
+				return pos + __builtin_ctz(m);
+			pos += 32;
+			continue;
+		}
+		if (a[pos] != b[pos] || !b[pos])
+			return pos;
+		pos++;
+	}
+}
+
+/* The resolvers run before relocations are complete, so they must only rely
+ * on the compiler's builtins.
+ */
+static unsigned int (*eb_memdiff_resolve(void))(const unsigned char *, const unsigned char *, unsigned int)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return eb_memdiff_avx2;
+	return eb_memdiff_generic;
+}
+
+static unsigned int (*eb_strdiff_resolve(void))(const unsigned char *, const unsigned char *)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return eb_strdiff_avx2;
+	if (__builtin_cpu_supports("sse4.2"))
+		return eb_strdiff_sse42;
+	return eb_strdiff_generic;
+}
+
+unsigned int eb_memdiff(const unsigned char *a, const unsigned char *b, unsigned int len)
+	__attribute__((ifunc("eb_memdiff_resolve")));
+
+unsigned int eb_strdiff(const unsigned char *a, const unsigned char *b)
+	__attribute__((ifunc("eb_strdiff_resolve")));
+
+/* Returns the name of the kernels in use, for reporting purposes */
+const char *eb_cmp_kernel(void)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return "avx2";
+	if (__builtin_cpu_supports("sse4.2"))
+		return "sse4.2";
+	return "generic";
+}
+
+#else /* !EB_CMP_IFUNC */
+
+unsigned int eb_memdiff(const unsigned char *a, const unsigned char *b, unsigned int len)
+{
+	return eb_memdiff_generic(a, b, len);
+}
+
+unsigned int eb_strdiff(const unsigned char *a, const unsigned char *b)
+{
+	return eb_strdiff_generic(a, b);
+}
+
+const char *eb_cmp_kernel(void)
+{
+	return "generic";
+}
+
+#endif /* EB_CMP_IFUNC */
@@ -0,0 +1,99 @@
+/*
+ * Elastic Binary Trees - exported functions for host name nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebhntree.h for more details about those functions */
+
+#include "ebhntree.h"
+
+/* Writes the key of the <len> chars host name or domain <name> to <dst>, which
+ * must have room for EBHN_KEY_SIZE(<len>) chars. Returns the key's length, or
+ * -1 if the name is too long or has an empty label.
+ */
+int ebhn_encode(char *dst, const char *name, unsigned int len)
+{
+	return __ebhn_encode(dst, name, len);
+}
+
+/* Writes the host name or domain stored in key <key> to <dst>, which must have
+ * room for as many chars as the key. Returns the name's length.
+ */
+int ebhn_decode(char *dst, const char *key)
+{
+	const char *label[EBHN_MAX_LEN / 2 + 2];
+	const char *p = key;
+	int nb = 0, len = 0;
+
+	/* each label starts after a star and ends before a dot, except for a
+	 * trailing wildcard.
+	 */
+	while (*p == '*' && nb < (int)(sizeof(label) / sizeof(label[0]))) {
+		label[nb++] = ++p;
+		while (*p && *p != '.')
+			p++;
+		if (!*p)
+			break;
+		p++;
+	}
+
+	while (nb--) {
+		p = label[nb];
+		if (!*p) {
+			/* the wildcard */
+			dst[len++] = '*';
+		}
+		while (*p && *p != '.')
+			dst[len++] = *p++;
+		if (nb)
+			dst[len++] = '.';
+	}
+	dst[len] = 0;
+	return len;
+}
+
+/* Insert ebmb_node <new> into subtree starting at node root <root>. Only
+ * new->key needs be set, with ebhn_encode(). The ebmb_node is returned. If
+ * root->b[EB_RGHT]==1, the tree may only contain unique keys.
+ */
+struct ebmb_node *ebhn_insert(struct eb_root *root, struct ebmb_node *new)
+{
+	return __ebst_insert(root, new);
+}
+
+/* Find the node holding exactly the zero-terminated host name <name> in tree
+ * <root>. If none can be found, return NULL.
+ */
+struct ebmb_node *ebhn_lookup(struct eb_root *root, const char *name)
+{
+	return __ebhn_lookup(root, name);
+}
+
+/* Find the node holding the most specific domain of tree <root> which matches
+ * the zero-terminated host name <name>. If none can be found, return NULL.
+ */
+struct ebmb_node *ebhn_lookup_longest(struct eb_root *root, const char *name)
+{
+	return __ebhn_lookup_longest(root, name);
+}
@@ -0,0 +1,150 @@
+/*
+ * Elastic Binary Trees - macros to manipulate host name nodes.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Host name trees are used to match host names against lists of domains, such
+ * as "example.com" matching "example.com" and "www.example.com" but neither
+ * "badexample.com" nor "com", or "*.example.com" matching "www.example.com"
+ * but not "example.com". They are ebst trees in which names are stored with
+ * their labels in reverse order, each one preceded by a star and followed by
+ * a dot, and in lower case : "www.Example.com" is stored as
+ * "*com.*example.*www.". A leading "*" label is stored as a single star, so
+ * "*.example.com" is stored as "*com.*example.*". This way, all the subdomains
+ * of a domain start with the domain's key, which only matches on label
+ * boundaries thanks to the trailing dot. The subdomains of a wildcard start
+ * with its key, but not the wildcard's domain itself since its key ends after
+ * the dot. The most specific entry matching a name is thus found in a single
+ * descent by ebst_lookup_longest(). A trailing dot in names is ignored. Nodes
+ * are ebmb_nodes whose key is set with ebhn_encode(), and which may be walked
+ * or deleted using the ebmb functions.
+ */
+
+#ifndef _EBHNTREE_H
+#define _EBHNTREE_H
+
+#include "ebtree.h"
+#include "ebsttree.h"
+
+/* Max length of a host name */
+#define EBHN_MAX_LEN	253
+
+/* Room needed for the key of a name of <len> chars, including the trailing
+ * zero. Each label adds two chars and drops a dot, and since labels may not be
+ * empty, each one takes at least two chars of the name with its dot.
+ */
+#define EBHN_KEY_SIZE(len)	((len) + (len) / 2 + 3)
+
+/* The following functions are not inlined by default. They are declared
+ * in ebhntree.c, which simply relies on their inline version.
+ */
+int ebhn_encode(char *dst, const char *name, unsigned int len);
+int ebhn_decode(char *dst, const char *key);
+struct ebmb_node *ebhn_insert(struct eb_root *root, struct ebmb_node *new);
+struct ebmb_node *ebhn_lookup(struct eb_root *root, const char *name);
+struct ebmb_node *ebhn_lookup_longest(struct eb_root *root, const char *name);
+
+/* Copies the labels of name <name> ending at <end> to <dst> in reverse order,
+ * each one preceded by a star and followed by a dot, then a trailing zero. A
+ * leading "*" label is only copied as a star. Upper case letters are turned to
+ * lower case. Returns the length of the result.
+ */
+static forceinline int __ebhn_reverse(char *dst, const char *name, const char *end)
+{
+	const char *p, *q;
+	char *d = dst;
+	unsigned char c;
+
+	while (end > name) {
+		p = end;
+		while (p > name && p[-1] != '.')
+			p--;
+		*d++ = '*';
+		if (p == name && end - p == 1 && *p == '*')
+			break;
+		for (q = p; q < end; q++) {
+			c = *q;
+			if (c >= 'A' && c <= 'Z')
+				c += 'a' - 'A';
+			*d++ = c;
+		}
+		*d++ = '.';
+		if (p == name)
+			break;
+		end = p - 1;
+	}
+	*d = 0;
+	return d - dst;
+}
+
+/* Writes the key of the <len> chars host name or domain <name> to <dst>, which
+ * must have room for EBHN_KEY_SIZE(<len>) chars. Returns the key's length, or
+ * -1 if the name is longer than EBHN_MAX_LEN or has an empty label, such as an
+ * empty name or one containing two consecutive dots.
+ */
+static forceinline int __ebhn_encode(char *dst, const char *name, unsigned int len)
+{
+	const char *end = name + len;
+	const char *p;
+
+	if (len && end[-1] == '.')
+		end--;
+	if (end == name || end - name > EBHN_MAX_LEN)
+		return -1;
+
+	/* empty labels would also make the key larger than EBHN_KEY_SIZE() */
+	if (*name == '.' || end[-1] == '.')
+		return -1;
+	for (p = name + 1; p < end; p++)
+		if (*p == '.' && p[-1] == '.')
+			return -1;
+	return __ebhn_reverse(dst, name, end);
+}
+
+/* Find the node holding exactly the zero-terminated host name <name> in tree
+ * <root>. If none can be found, return NULL.
+ */
+static forceinline struct ebmb_node *__ebhn_lookup(struct eb_root *root, const char *name)
+{
+	char key[EBHN_KEY_SIZE(EBHN_MAX_LEN)];
+
+	if (__ebhn_encode(key, name, strlen(name)) < 0)
+		return NULL;
+	return __ebst_lookup(root, key);
+}
+
+/* Find the node holding the most specific domain of tree <root> which matches
+ * the zero-terminated host name <name>, either because it is this name or one
+ * of its parent domains. If none can be found, return NULL.
+ */
+static forceinline struct ebmb_node *__ebhn_lookup_longest(struct eb_root *root, const char *name)
+{
+	char key[EBHN_KEY_SIZE(EBHN_MAX_LEN)];
+
+	if (__ebhn_encode(key, name, strlen(name)) < 0)
+		return NULL;
+	return __ebst_lookup_longest(root, key);
+}
+
+#endif /* _EBHNTREE_H */
@@ -0,0 +1,468 @@
+/*
+ * Elastic Binary Trees - macros for Indirect Multi-Byte data nodes with a
+ * cached key head.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _EBIMCTREE_H
+#define _EBIMCTREE_H
+
+#include <string.h>
+#include "ebtree.h"
+
+/* These functions and macros work like the ebim ones, except that the nodes
+ * also carry a copy of the first bytes of the indirect key, called the head.
+ * Most nodes visited during a descent only differ in these first bytes, so
+ * lookups and insertions only dereference the external key of the nodes they
+ * need to compare past the head. The head is filled by the insert functions
+ * and the key must not change while the node is in the tree.
+ */
+
+/* Return the structure of type <type> whose member <member> points to <ptr> */
+#define ebic_entry(ptr, type, member) container_of(ptr, type, member)
+
+/* Number of key bytes copied into the node */
+#define EBIC_HEAD_LEN	8
+
+/* This structure carries a node, a leaf, a pointer to the key, and a copy of
+ * the key's first bytes, zero-padded for keys shorter than EBIC_HEAD_LEN. It
+ * must start with the eb_node so that it can be cast into an eb_node.
+ */
+struct ebic_node {
+	struct eb_node node; /* the tree node, must be at the beginning */
+	ALWAYS_ALIGN(sizeof(void*));
+	void *key;
+	unsigned char head[EBIC_HEAD_LEN];
+} ALIGNED(sizeof(void*));
+
+/* Return leftmost node in the tree, or NULL if none */
+static forceinline struct ebic_node *ebic_first(struct eb_root *root)
+{
+	return ebic_entry(eb_first(root), struct ebic_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+static forceinline struct ebic_node *ebic_last(struct eb_root *root)
+{
+	return ebic_entry(eb_last(root), struct ebic_node, node);
+}
+
+/* Return next node in the tree, or NULL if none */
+static forceinline struct ebic_node *ebic_next(struct ebic_node *ebic)
+{
+	return ebic_entry(eb_next(&ebic->node), struct ebic_node, node);
+}
+
+/* Return previous node in the tree, or NULL if none */
+static forceinline struct ebic_node *ebic_prev(struct ebic_node *ebic)
+{
+	return ebic_entry(eb_prev(&ebic->node), struct ebic_node, node);
+}
+
+/* Return next leaf node within a duplicate sub-tree, or NULL if none. */
+static inline struct ebic_node *ebic_next_dup(struct ebic_node *ebic)
+{
+	return ebic_entry(eb_next_dup(&ebic->node), struct ebic_node, node);
+}
+
+/* Return previous leaf node within a duplicate sub-tree, or NULL if none. */
+static inline struct ebic_node *ebic_prev_dup(struct ebic_node *ebic)
+{
+	return ebic_entry(eb_prev_dup(&ebic->node), struct ebic_node, node);
+}
+
+/* Return next node in the tree, skipping duplicates, or NULL if none */
+static forceinline struct ebic_node *ebic_next_unique(struct ebic_node *ebic)
+{
+	return ebic_entry(eb_next_unique(&ebic->node), struct ebic_node, node);
+}
+
+/* Return previous node in the tree, skipping duplicates, or NULL if none */
+static forceinline struct ebic_node *ebic_prev_unique(struct ebic_node *ebic)
+{
+	return ebic_entry(eb_prev_unique(&ebic->node), struct ebic_node, node);
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. Note
+ * that this function relies on a non-inlined generic function: eb_delete.
+ */
+static forceinline void ebic_delete(struct ebic_node *ebic)
+{
+	eb_delete(&ebic->node);
+}
+
+/* The following functions are not inlined by default. They are declared
+ * in ebimctree.c, which simply relies on their inline version.
+ */
+struct ebic_node *ebimc_lookup(struct eb_root *root, const void *x, unsigned int len);
+struct ebic_node *ebimc_insert(struct eb_root *root, struct ebic_node *new, unsigned int len);
+
+/* Delete node from the tree if it was linked in. Mark the node unused. */
+static forceinline void __ebic_delete(struct ebic_node *ebic)
+{
+	__eb_delete(&ebic->node);
+}
+
+/* Return byte <pos> of the key of node <node>, from the head when possible */
+static forceinline unsigned char ebic_byte(const struct ebic_node *node, unsigned int pos)
+{
+	if (pos < EBIC_HEAD_LEN)
+		return node->head[pos];
+	return ((const unsigned char *)node->key)[pos];
+}
+
+/* Compare <len> bytes of the key of node <node> starting at <pos> with <x>,
+ * like memcmp() does. Only the part past the head is read from the key.
+ */
+static forceinline int ebic_memcmp(const struct ebic_node *node, unsigned int pos,
+				   const unsigned char *x, unsigned int len)
+{
+	int ret;
+
+	for (; pos < EBIC_HEAD_LEN && len; pos++, x++, len--) {
+		ret = node->head[pos] - *x;
+		if (ret)
+			return ret;
+	}
+	if (!len)
+		return 0;
+	return memcmp((const unsigned char *)node->key + pos, x, len);
+}
+
+/* Same as equal_bits(a, node->key, ignore, len), only reading the key past
+ * the head.
+ */
+static forceinline int ebic_equal_bits(const unsigned char *a, const struct ebic_node *node,
+				       int ignore, int len)
+{
+	int hlen;
+
+	if (ignore < EBIC_HEAD_LEN * 8) {
+		hlen = len < EBIC_HEAD_LEN * 8 ? len : EBIC_HEAD_LEN * 8;
+		ignore = equal_bits(a, node->head, ignore, hlen);
+		if (ignore < hlen || len <= EBIC_HEAD_LEN * 8)
+			return ignore;
+	}
+	return equal_bits(a, node->key, ignore, len);
+}
+
+/* Same as cmp_bits(a, node->key, pos), only reading the key past the head */
+static forceinline int ebic_cmp_bits(const unsigned char *a, const struct ebic_node *node,
+				     unsigned int pos)
+{
+	if (pos < EBIC_HEAD_LEN * 8)
+		return cmp_bits(a, node->head, pos);
+	return cmp_bits(a, node->key, pos);
+}
+
+/* Find the first occurence of a key of a least <len> bytes matching <x> in the
+ * tree <root>. The caller is responsible for ensuring that <len> will not exceed
+ * the common parts between the tree's keys and <x>. In case of multiple matches,
+ * the leftmost node is returned. This means that this function can be used to
+ * lookup string keys by prefix if all keys in the tree are zero-terminated. If
+ * no match is found, NULL is returned. Returns first node if <len> is zero.
+ */
+static forceinline struct ebic_node *
+__ebimc_lookup(struct eb_root *root, const void *x, unsigned int len)
+{
+	struct ebic_node *node;
+	eb_troot_t *troot;
+	int pos, side;
+	int node_bit;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		goto ret_null;
+
+	if (unlikely(len == 0))
+		goto walk_down;
+
+	pos = 0;
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebic_node, node.branches);
+			if (ebic_memcmp(node, pos, x, len) != 0)
+				goto ret_null;
+			else
+				goto ret_node;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebic_node, node.branches);
+
+		node_bit = node->node.bit;
+		if (node_bit < 0) {
+			/* We have a dup tree now. Either it's for the same
+			 * value, and we walk down left, or it's a different
+			 * one and we don't have our key.
+			 */
+			if (ebic_memcmp(node, pos, x, len) != 0)
+				goto ret_null;
+			else
+				goto walk_left;
+		}
+
+		/* OK, normal data node, let's walk down. We check if all full
+		 * bytes are equal, and we start from the last one we did not
+		 * completely check. We stop as soon as we reach the last byte,
+		 * because we must decide to go left/right or abort.
+		 */
+		node_bit = ~node_bit + (pos << 3) + 8; /* = (pos<<3) + (7 - node_bit) */
+		if (node_bit < 0) {
+			/* This surprizing construction gives better performance
+			 * because gcc does not try to reorder the loop. Tested to
+			 * be fine with 2.95 to 4.2.
+			 */
+			while (1) {
+				if (ebic_byte(node, pos++) ^ *(unsigned char*)(x++))
+					goto ret_null; /* more than one full byte is different */
+				if (--len == 0)
+					goto walk_left; /* return first node if all bytes matched */
+				node_bit += 8;
+				if (node_bit >= 0)
+					break;
+			}
+		}
+
+		/* here we know that only the last byte differs, so node_bit < 8.
+		 * We have 2 possibilities :
+		 *   - more than the last bit differs => return NULL
+		 *   - walk down on side = (x[pos] >> node_bit) & 1
+		 */
+		side = *(unsigned char *)x >> node_bit;
+		if (((ebic_byte(node, pos) >> node_bit) ^ side) > 1)
+			goto ret_null;
+		side &= 1;
+		troot = node->node.branches.b[side];
+	}
+ walk_left:
+	troot = node->node.branches.b[EB_LEFT];
+ walk_down:
+	while (eb_gettag(troot) != EB_LEAF)
+		troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+	node = container_of(eb_untag(troot, EB_LEAF),
+			    struct ebic_node, node.branches);
+ ret_node:
+	return node;
+ ret_null:
+	return NULL;
+}
+
+/* Insert ebic_node <new> into subtree starting at node root <root>.
+ * Only new->key needs be set with the key, the head is filled here. The
+ * ebic_node is returned. If root->b[EB_RGHT]==1, the tree may only contain
+ * unique keys. The len is specified in bytes.
+ */
+static forceinline struct ebic_node *
+__ebimc_insert(struct eb_root *root, struct ebic_node *new, unsigned int len)
+{
+	struct ebic_node *old;
+	unsigned int side;
+	eb_troot_t *troot;
+	eb_troot_t *root_right;
+	int diff;
+	int bit;
+	int old_node_bit;
+
+	memset(new->head, 0, EBIC_HEAD_LEN);
+	memcpy(new->head, new->key, len < EBIC_HEAD_LEN ? len : EBIC_HEAD_LEN);
+
+	side = EB_LEFT;
+	troot = root->b[EB_LEFT];
+	root_right = root->b[EB_RGHT];
+	if (unlikely(troot == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		root->b[EB_LEFT] = eb_dotag(&new->node.branches, EB_LEAF);
+		new->node.leaf_p = eb_dotag(root, EB_LEFT);
+		new->node.node_p = NULL; /* node part unused */
+		return new;
+	}
+
+	len <<= 3;
+
+	/* The tree descent is fairly easy :
+	 *  - first, check if we have reached a leaf node
+	 *  - second, check if we have gone too far
+	 *  - third, reiterate
+	 * Everywhere, we use <new> for the node node we are inserting, <root>
+	 * for the node we attach it to, and <old> for the node we are
+	 * displacing below <new>. <troot> will always point to the future node
+	 * (tagged with its type). <side> carries the side the node <new> is
+	 * attached to below its parent, which is also where previous node
+	 * was attached.
+	 */
+
+	bit = 0;
+	while (1) {
+		if (unlikely(eb_gettag(troot) == EB_LEAF)) {
+			eb_troot_t *new_left, *new_rght;
+			eb_troot_t *new_leaf, *old_leaf;
+
+			old = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebic_node, node.branches);
+
+			new_left = eb_dotag(&new->node.branches, EB_LEFT);
+			new_rght = eb_dotag(&new->node.branches, EB_RGHT);
+			new_leaf = eb_dotag(&new->node.branches, EB_LEAF);
+			old_leaf = eb_dotag(&old->node.branches, EB_LEAF);
+
+			new->node.node_p = old->node.leaf_p;
+
+			/* Right here, we have 3 possibilities :
+			 * - the tree does not contain the key, and we have
+			 *   new->key < old->key. We insert new above old, on
+			 *   the left ;
+			 *
+			 * - the tree does not contain the key, and we have
+			 *   new->key > old->key. We insert new above old, on
+			 *   the right ;
+			 *
+			 * - the tree does contain the key, which implies it
+			 *   is alone. We add the new key next to it as a
+			 *   first duplicate.
+			 *
+			 * The last two cases can easily be partially merged.
+			 */
+			bit = ebic_equal_bits(new->key, old, bit, len);
+
+			/* Note: we can compare more bits than the current node's because as
+			 * long as they are identical, we know we descend along the correct
+			 * side. However we don't want to start to compare past the end.
+			 */
+			diff = 0;
+			if ((unsigned)bit < len)
+				diff = ebic_cmp_bits(new->key, old, bit);
+
+			if (diff < 0) {
+				new->node.leaf_p = new_left;
+				old->node.leaf_p = new_rght;
+				new->node.branches.b[EB_LEFT] = new_leaf;
+				new->node.branches.b[EB_RGHT] = old_leaf;
+			} else {
+				/* we may refuse to duplicate this key if the tree is
+				 * tagged as containing only unique keys.
+				 */
+				if (diff == 0 && eb_gettag(root_right))
+					return old;
+
+				/* new->key >= old->key, new goes the right */
+				old->node.leaf_p = new_left;
+				new->node.leaf_p = new_rght;
+				new->node.branches.b[EB_LEFT] = old_leaf;
+				new->node.branches.b[EB_RGHT] = new_leaf;
+
+				if (diff == 0) {
+					new->node.bit = -1;
+					root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+					return new;
+				}
+			}
+			break;
+		}
+
+		/* OK we're walking down this link */
+		old = container_of(eb_untag(troot, EB_NODE),
+				   struct ebic_node, node.branches);
+		old_node_bit = old->node.bit;
+
+		/* Stop going down when we don't have common bits anymore. We
+		 * also stop in front of a duplicates tree because it means we
+		 * have to insert above. Note: we can compare more bits than
+		 * the current node's because as long as they are identical, we
+		 * know we descend along the correct side.
+		 */
+		if (old_node_bit < 0) {
+			/* we're above a duplicate tree, we must compare till the end */
+			bit = ebic_equal_bits(new->key, old, bit, len);
+			goto dup_tree;
+		}
+		else if (bit < old_node_bit) {
+			bit = ebic_equal_bits(new->key, old, bit, old_node_bit);
+		}
+
+		if (bit < old_node_bit) { /* we don't have all bits in common */
+			/* The tree did not contain the key, so we insert <new> before the node
+			 * <old>, and set ->bit to designate the lowest bit position in <new>
+			 * which applies to ->branches.b[].
+			 */
+			eb_troot_t *new_left, *new_rght;
+			eb_troot_t *new_leaf, *old_node;
+
+		dup_tree:
+			new_left = eb_dotag(&new->node.branches, EB_LEFT);
+			new_rght = eb_dotag(&new->node.branches, EB_RGHT);
+			new_leaf = eb_dotag(&new->node.branches, EB_LEAF);
+			old_node = eb_dotag(&old->node.branches, EB_NODE);
+
+			new->node.node_p = old->node.node_p;
+
+			/* Note: we can compare more bits than the current node's because as
+			 * long as they are identical, we know we descend along the correct
+			 * side. However we don't want to start to compare past the end.
+			 */
+			diff = 0;
+			if ((unsigned)bit < len)
+				diff = ebic_cmp_bits(new->key, old, bit);
+
+			if (diff < 0) {
+				new->node.leaf_p = new_left;
+				old->node.node_p = new_rght;
+				new->node.branches.b[EB_LEFT] = new_leaf;
+				new->node.branches.b[EB_RGHT] = old_node;
+			}
+			else if (diff > 0) {
+				old->node.node_p = new_left;
+				new->node.leaf_p = new_rght;
+				new->node.branches.b[EB_LEFT] = old_node;
+				new->node.branches.b[EB_RGHT] = new_leaf;
+			}
+			else {
+				struct eb_node *ret;
+				ret = eb_insert_dup(&old->node, &new->node);
+				return container_of(ret, struct ebic_node, node);
+			}
+			break;
+		}
+
+		/* walk down */
+		root = &old->node.branches;
+		side = (((unsigned char *)new->key)[old_node_bit >> 3] >> (~old_node_bit & 7)) & 1;
+		troot = root->b[side];
+	}
+
+	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
+	 * parent is already set to <new>, and the <root>'s branch is still in
+	 * <side>. Update the root's leaf till we have it. Note that we can also
+	 * find the side by checking the side of new->node.node_p.
+	 */
+
+	/* We need the common higher bits between new->key and old->key.
+	 * This number of bits is already in <bit>.
+	 */
+	new->node.bit = bit;
+	root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+	return new;
+}
+
+#endif /* _EBIMCTREE_H */
@@ -213,7 +213,7 @@ __ebim_insert(struct eb_root *root, struct ebpt_node *new, unsigned int len)
 			 * side. However we don't want to start to compare past the end.
 			 */
 			diff = 0;
-			if (((unsigned)bit >> 3) < len)
+			if ((unsigned)bit < len)
 				diff = cmp_bits(new->key, old->key, bit);
 
 			if (diff < 0) {
@@ -284,7 +284,7 @@ __ebim_insert(struct eb_root *root, struct ebpt_node *new, unsigned int len)
 			 * side. However we don't want to start to compare past the end.
 			 */
 			diff = 0;
-			if (((unsigned)bit >> 3) < len)
+			if ((unsigned)bit < len)
 				diff = cmp_bits(new->key, old->key, bit);
 
 			if (diff < 0) {
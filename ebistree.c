@@ -46,3 +46,36 @@ struct ebpt_node *ebis_insert(struct eb_root *root, struct ebpt_node *new)
 {
 	return __ebis_insert(root, new);
 }
+
+/* Find the first occurence of the longest string of tree <root> which is a
+ * prefix of the zero-terminated string <x>, including <x> itself. It's the
+ * caller's reponsibility to use this function only on trees which only
+ * contain zero-terminated strings. If none can be found, return NULL.
+ */
+struct ebpt_node *ebis_lookup_longest(struct eb_root *root, const char *x)
+{
+	return __ebis_lookup_longest(root, x);
+}
+
+/* Sets cursor <cur> to walk at most <limit> strings of tree <root> (all of
+ * them if <limit> is zero) starting with the first <len> chars of <x>. It's
+ * the caller's reponsibility to use this function only on trees which only
+ * contain zero-terminated strings. Returns non-zero if at least one string
+ * matches.
+ */
+int ebis_prefix_cursor(struct eb_root *root, const char *x, unsigned int len,
+                       unsigned long limit, struct eb_cursor *cur)
+{
+	return __ebis_prefix_cursor(root, x, len, limit, cur);
+}
+
+/* Deletes all the strings of tree <root> starting with the first <len> chars
+ * of <x>, and passes their nodes to <fn> with <arg> if <fn> is not NULL. It's
+ * the caller's reponsibility to use this function only on trees which only
+ * contain zero-terminated strings. Returns the number of deleted strings.
+ */
+unsigned long ebis_delete_prefix(struct eb_root *root, const char *x, unsigned int len,
+                                 void (*fn)(struct eb_node *node, void *arg), void *arg)
+{
+	return __ebis_delete_prefix(root, x, len, fn, arg);
+}
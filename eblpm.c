@@ -0,0 +1,130 @@
+/*
+ * Elastic Binary Trees - longest prefix match with a direct-indexed front table.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult eblpm.h for more details about those functions */
+
+#include <stdlib.h>
+#include "eblpm.h"
+
+/* Initializes tree <root> to use a table of 2^<bits> slots (at most 24 bits).
+ * <unique> indicates whether duplicate keys are refused. Returns non-zero on
+ * success or zero if memory could not be allocated.
+ */
+int eblpm_init(struct eblpm_root *root, unsigned int bits, int unique)
+{
+	struct eb_root empty = unique ? (struct eb_root)EB_ROOT_UNIQUE : (struct eb_root)EB_ROOT;
+	unsigned int i;
+
+	if (bits > 24)
+		bits = 24;
+
+	root->bits = bits;
+	root->shorts = empty;
+	root->slots = malloc(sizeof(*root->slots) << bits);
+	if (!root->slots)
+		return 0;
+
+	for (i = 0; i < (1U << bits); i++) {
+		root->slots[i].root = empty;
+		root->slots[i].cover = NULL;
+	}
+	return 1;
+}
+
+/* Releases the table of tree <root>. The nodes are not touched. */
+void eblpm_destroy(struct eblpm_root *root)
+{
+	free(root->slots);
+	root->slots = NULL;
+}
+
+/* Finds the first occurrence of the longest prefix matching key <x> in tree
+ * <root>, with the same semantics as ebmb_lookup_longest(). Returns NULL if
+ * none matches.
+ */
+struct ebmb_node *eblpm_lookup_longest(struct eblpm_root *root, const void *x)
+{
+	struct eblpm_slot *s = eblpm_slot(root, x);
+	struct ebmb_node *node;
+
+	node = __ebmb_lookup_longest(&s->root, x);
+	return node ? node : s->cover;
+}
+
+/* Inserts ebmb_node <new> into tree <root>, with the same semantics as
+ * ebmb_insert_prefix(). A prefix shorter than the table's bits becomes the
+ * cover of the slots it covers unless they already have a longer one.
+ */
+struct ebmb_node *eblpm_insert_prefix(struct eblpm_root *root, struct ebmb_node *new, unsigned int len)
+{
+	struct eblpm_slot *s;
+	struct ebmb_node *ret;
+	unsigned int first, nb;
+
+	if (new->node.pfx >= root->bits)
+		return __ebmb_insert_prefix(&eblpm_slot(root, new->key)->root, new, len);
+
+	ret = __ebmb_insert_prefix(&root->shorts, new, len);
+	if (ret != new)
+		return ret;
+
+	nb = 1U << (root->bits - new->node.pfx);
+	first = eblpm_index(root, new->key) & -nb;
+	for (s = &root->slots[first]; s < &root->slots[first + nb]; s++) {
+		if (!s->cover || s->cover->node.pfx < new->node.pfx)
+			s->cover = new;
+	}
+	return new;
+}
+
+/* Removes node <node> from tree <root> if it is there. If it was the cover of
+ * some slots, they get the next longest prefix covering <node>'s prefix.
+ */
+void eblpm_delete(struct eblpm_root *root, struct ebmb_node *node)
+{
+	struct eblpm_slot *s;
+	struct ebmb_node *next;
+	unsigned int first, nb;
+	int pfx;
+
+	__ebmb_delete(node);
+	if (node->node.pfx >= root->bits)
+		return;
+
+	/* a longer prefix covering the slots would already be their cover,
+	 * so only shorter or equal prefixes may replace <node>.
+	 */
+	next = NULL;
+	for (pfx = node->node.pfx; pfx >= 0 && !next; pfx--)
+		next = __ebmb_lookup_prefix(&root->shorts, node->key, pfx);
+
+	nb = 1U << (root->bits - node->node.pfx);
+	first = eblpm_index(root, node->key) & -nb;
+	for (s = &root->slots[first]; s < &root->slots[first + nb]; s++) {
+		if (s->cover == node)
+			s->cover = next;
+	}
+}
@@ -0,0 +1,94 @@
+/*
+ * Elastic Binary Trees - longest prefix match with a direct-indexed front table.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* An eblpm tree is an ebmb prefix tree whose first <bits> bits (at most 24)
+ * are resolved by a direct-indexed table instead of walking down one node per
+ * bit. Each of the 2^bits slots describes all the keys starting with its
+ * index :
+ *   - an ebmb prefix tree holding the prefixes of at least <bits> bits which
+ *     belong to this slot ;
+ *   - the longest prefix shorter than <bits> bits covering the whole slot, if
+ *     any, which is the result of a lookup finding nothing in the tree.
+ *
+ * Prefixes shorter than <bits> bits are also stored in a separate tree, only
+ * used to find the next cover of a slot when one is deleted. Inserting or
+ * deleting such a prefix updates the 2^(bits-pfx) slots it covers, which is
+ * cheap for the few short prefixes found in real routing tables. A lookup
+ * thus costs one table access and a walk down a small tree. The table uses
+ * 24 bytes per slot on 64-bit machines, so 1.5 MB for 16 bits and 384 MB for
+ * 24 bits. All keys must be at least 1, 2 or 3 bytes long for tables of up to
+ * 8, 16 or 24 bits respectively.
+ */
+
+#ifndef _EBLPM_H
+#define _EBLPM_H
+
+#include "ebmbtree.h"
+
+/* Default number of bits resolved by the table */
+#define EBLPM_BITS	16
+
+/* One slot of the front table */
+struct eblpm_slot {
+	struct eb_root root;             /* prefixes of at least <bits> bits */
+	struct ebmb_node *cover;         /* longest shorter prefix covering the slot */
+};
+
+/* The root of an eblpm tree */
+struct eblpm_root {
+	unsigned int bits;               /* number of key bits used to select a slot */
+	struct eblpm_slot *slots;        /* 1 << bits slots */
+	struct eb_root shorts;           /* prefixes shorter than <bits> bits */
+};
+
+/* The following functions are not inlined. They are declared in eblpm.c. */
+int eblpm_init(struct eblpm_root *root, unsigned int bits, int unique);
+void eblpm_destroy(struct eblpm_root *root);
+struct ebmb_node *eblpm_lookup_longest(struct eblpm_root *root, const void *x);
+struct ebmb_node *eblpm_insert_prefix(struct eblpm_root *root, struct ebmb_node *new, unsigned int len);
+void eblpm_delete(struct eblpm_root *root, struct ebmb_node *node);
+
+/* Returns the index of the slot of tree <root> which stores key <x> */
+static inline unsigned int eblpm_index(const struct eblpm_root *root, const void *x)
+{
+	const unsigned char *k = x;
+
+	if (!root->bits)
+		return 0;
+	if (root->bits <= 8)
+		return k[0] >> (8 - root->bits);
+	if (root->bits <= 16)
+		return ((k[0] << 8) | k[1]) >> (16 - root->bits);
+	return ((k[0] << 16) | (k[1] << 8) | k[2]) >> (24 - root->bits);
+}
+
+/* Returns the slot of tree <root> which stores key <x> */
+static inline struct eblpm_slot *eblpm_slot(const struct eblpm_root *root, const void *x)
+{
+	return &root->slots[eblpm_index(root, x)];
+}
+
+#endif /* _EBLPM_H */
@@ -48,6 +48,26 @@ ebmb_insert(struct eb_root *root, struct ebmb_node *new, unsigned int len)
 	return __ebmb_insert(root, new, len);
 }
 
+/* Sets cursor <cur> to walk at most <limit> keys of tree <root> (all of them
+ * if <limit> is zero) starting with the <len> bytes of <x>. Returns non-zero
+ * if at least one key matches.
+ */
+int ebmb_prefix_cursor(struct eb_root *root, const void *x, unsigned int len,
+                       unsigned long limit, struct eb_cursor *cur)
+{
+	return __ebmb_prefix_cursor(root, x, len, limit, cur);
+}
+
+/* Deletes all the keys of tree <root> starting with the <len> bytes of <x>,
+ * and passes their nodes to <fn> with <arg> if <fn> is not NULL. Returns the
+ * number of deleted keys.
+ */
+unsigned long ebmb_delete_prefix(struct eb_root *root, const void *x, unsigned int len,
+                                 void (*fn)(struct eb_node *node, void *arg), void *arg)
+{
+	return __ebmb_delete_prefix(root, x, len, fn, arg);
+}
+
 /* Find the first occurence of the longest prefix matching a key <x> in the
  * tree <root>. It's the caller's responsibility to ensure that key <x> is at
  * least as long as the keys in the tree. If none can be found, return NULL.
@@ -58,6 +78,17 @@ ebmb_lookup_longest(struct eb_root *root, const void *x)
 	return __ebmb_lookup_longest(root, x);
 }
 
+/* Find the first occurence of the longest prefix matching each of the <nb>
+ * keys located every <stride> bytes from <keys> in the tree <root>, and store
+ * them into <res>, which receives NULL for keys not matching any prefix. The
+ * lookups are interleaved so that their cache misses overlap.
+ */
+void ebmb_lookup_longest_batch(struct eb_root *root, const void *keys, unsigned long stride,
+                               unsigned int nb, struct ebmb_node **res)
+{
+	__ebmb_lookup_longest_batch(root, keys, stride, nb, res);
+}
+
 /* Find the first occurence of a prefix matching a key <x> of <pfx> BITS in the
  * tree <root>. If none can be found, return NULL.
  */
@@ -81,3 +112,29 @@ ebmb_insert_prefix(struct eb_root *root, struct ebmb_node *new, unsigned int len
 {
 	return __ebmb_insert_prefix(root, new, len);
 }
+
+/* Find the first occurence of a key of <len> bytes in the tree <root>, using
+ * 64-bit words when <len> is a multiple of 8. If none can be found, return
+ * NULL.
+ */
+struct ebmb_node *
+ebmb_lookup_w(struct eb_root *root, const void *x, unsigned int len)
+{
+	return __ebmb_lookup_w(root, x, len);
+}
+
+/* Insert ebmb_node <new> into subtree starting at node root <root>, using
+ * 64-bit words when <len> is a multiple of 8. Same semantics as ebmb_insert().
+ */
+struct ebmb_node *
+ebmb_insert_w(struct eb_root *root, struct ebmb_node *new, unsigned int len)
+{
+	return __ebmb_insert_w(root, new, len);
+}
+
+/* Fixed-length functions, see EBMB_DEFINE_FIXED() in ebmbtree.h */
+EBMB_DEFINE_FIXED(4)
+EBMB_DEFINE_FIXED(8)
+EBMB_DEFINE_FIXED(16)
+EBMB_DEFINE_FIXED(20)
+EBMB_DEFINE_FIXED(32)
@@ -107,6 +107,12 @@ static forceinline struct ebmb_node *ebmb_prev_unique(struct ebmb_node *ebmb)
 	return ebmb_entry(eb_prev_unique(&ebmb->node), struct ebmb_node, node);
 }
 
+/* Return the next node of cursor <cur>, or NULL if none */
+static inline struct ebmb_node *ebmb_cursor_next(struct eb_cursor *cur)
+{
+	return ebmb_entry(eb_cursor_next(cur), struct ebmb_node, node);
+}
+
 /* Delete node from the tree if it was linked in. Mark the node unused. Note
  * that this function relies on a non-inlined generic function: eb_delete.
  */
@@ -120,9 +126,48 @@ static forceinline void ebmb_delete(struct ebmb_node *ebmb)
  */
 struct ebmb_node *ebmb_lookup(struct eb_root *root, const void *x, unsigned int len);
 struct ebmb_node *ebmb_insert(struct eb_root *root, struct ebmb_node *new, unsigned int len);
+int ebmb_prefix_cursor(struct eb_root *root, const void *x, unsigned int len,
+                       unsigned long limit, struct eb_cursor *cur);
+unsigned long ebmb_delete_prefix(struct eb_root *root, const void *x, unsigned int len,
+                                 void (*fn)(struct eb_node *node, void *arg), void *arg);
 struct ebmb_node *ebmb_lookup_longest(struct eb_root *root, const void *x);
 struct ebmb_node *ebmb_lookup_prefix(struct eb_root *root, const void *x, unsigned int pfx);
 struct ebmb_node *ebmb_insert_prefix(struct eb_root *root, struct ebmb_node *new, unsigned int len);
+void ebmb_lookup_longest_batch(struct eb_root *root, const void *keys, unsigned long stride,
+                               unsigned int nb, struct ebmb_node **res);
+struct ebmb_node *ebmb_lookup_w(struct eb_root *root, const void *x, unsigned int len);
+struct ebmb_node *ebmb_insert_w(struct eb_root *root, struct ebmb_node *new, unsigned int len);
+
+/* Fixed-length trees. When all keys of a tree have the same length, which is
+ * known at build time, EBMB_DEFINE_FIXED(len) instanciates ebmb<len>_lookup()
+ * and ebmb<len>_insert() which pass this constant length to the inlined
+ * functions. The compiler may then unroll the key comparisons and drop all
+ * length checks. These ones always use the word functions.
+ * EBMB_DECLARE_FIXED(len) declares them. The trees are the same as with the
+ * generic functions so both may be mixed.
+ */
+#define EBMB_DECLARE_FIXED(len)							\
+	struct ebmb_node *ebmb##len##_lookup(struct eb_root *root, const void *x);	\
+	struct ebmb_node *ebmb##len##_insert(struct eb_root *root, struct ebmb_node *new)
+
+#define EBMB_DEFINE_FIXED(len)							\
+	struct ebmb_node *ebmb##len##_lookup(struct eb_root *root, const void *x)	\
+	{									\
+		return __ebmb_lookup_w(root, x, len);				\
+	}									\
+	struct ebmb_node *ebmb##len##_insert(struct eb_root *root, struct ebmb_node *new) \
+	{									\
+		return __ebmb_insert_w(root, new, len);				\
+	}
+
+/* These ones are declared in ebmbtree.c : 4 bytes for IPv4 addresses, 8 for
+ * 64-bit IDs, 16 for IPv6 addresses and UUIDs, 20 for SHA1 and 32 for SHA256.
+ */
+EBMB_DECLARE_FIXED(4);
+EBMB_DECLARE_FIXED(8);
+EBMB_DECLARE_FIXED(16);
+EBMB_DECLARE_FIXED(20);
+EBMB_DECLARE_FIXED(32);
 
 /* The following functions are less likely to be used directly, because their
  * code is larger. The non-inlined version is preferred.
@@ -186,6 +231,35 @@ static forceinline struct ebmb_node *__ebmb_lookup(struct eb_root *root, const v
 		 * because we must decide to go left/right or abort.
 		 */
 		node_bit = ~node_bit + (pos << 3) + 8; /* = (pos<<3) + (7 - node_bit) */
+#if defined(EB_CPU_DISPATCH)
+		/* compare all full bytes at once, leaving at least the last
+		 * byte of the key to the loop below.
+		 */
+		if (node_bit <= -8 && len > 1) {
+			unsigned int n = -node_bit >> 3;
+
+			if (n > len - 1)
+				n = len - 1;
+			if (eb_memdiff(node->key + pos, x, n) < n)
+				goto ret_null;
+			pos += n;
+			x += n;
+			len -= n;
+			node_bit += n << 3;
+		}
+#elif defined(EB_BLOCK_SIZE)
+		/* skip whole identical blocks first, leaving the last bytes
+		 * of the key to the loop below.
+		 */
+		while (node_bit <= -8 * (int)EB_BLOCK_SIZE && len > EB_BLOCK_SIZE) {
+			if (eb_block_first(node->key + pos, x, 0) < EB_BLOCK_SIZE)
+				goto ret_null;
+			pos += EB_BLOCK_SIZE;
+			x += EB_BLOCK_SIZE;
+			len -= EB_BLOCK_SIZE;
+			node_bit += 8 * EB_BLOCK_SIZE;
+		}
+#endif
 		if (node_bit < 0) {
 			/* This surprizing construction gives better performance
 			 * because gcc does not try to reorder the loop. Tested to
@@ -226,6 +300,65 @@ static forceinline struct ebmb_node *__ebmb_lookup(struct eb_root *root, const v
 	return NULL;
 }
 
+/* Returns the branch pointer of tree <root> holding all the keys starting with
+ * the <len> bytes of <x> and only them, or NULL if there are none. All keys
+ * below a node share as many bits as the node's position, so the tree is
+ * walked down following <x> until a node's position is past <len> bytes, and
+ * the keys below it are either all or none of the expected ones. This does not
+ * apply to prefix trees.
+ */
+static forceinline eb_troot_t *__ebmb_prefix_subtree(struct eb_root *root, const void *x, unsigned int len)
+{
+	struct ebmb_node *node;
+	eb_troot_t *troot;
+	int node_bit;
+
+	troot = root->b[EB_LEFT];
+	while (eb_gettag(troot) == EB_NODE) {
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebmb_node, node.branches);
+		node_bit = node->node.bit;
+		if (node_bit < 0 || node_bit >= (int)(len << 3))
+			break;
+		troot = node->node.branches.b[(((unsigned char*)x)[node_bit >> 3] >>
+					       (~node_bit & 7)) & 1];
+	}
+
+	if (troot) {
+		/* any leaf of the subtree tells whether it matches */
+		node = container_of(eb_walk_down(troot, EB_LEFT), struct ebmb_node, node);
+		if (memcmp(node->key, x, len) != 0)
+			troot = NULL;
+	}
+	return troot;
+}
+
+/* Sets cursor <cur> to walk at most <limit> keys of tree <root> (all of them
+ * if <limit> is zero) starting with the <len> bytes of <x>, in ascending
+ * order. Only the leaves of the subtree holding them are visited. Returns
+ * non-zero if at least one key matches, otherwise zero with an empty cursor.
+ */
+static forceinline int __ebmb_prefix_cursor(struct eb_root *root, const void *x, unsigned int len,
+                                            unsigned long limit, struct eb_cursor *cur)
+{
+	eb_troot_t *troot = __ebmb_prefix_subtree(root, x, len);
+
+	eb_cursor_init(cur, troot, limit);
+	return troot != NULL;
+}
+
+/* Deletes all the keys of tree <root> starting with the <len> bytes of <x>,
+ * and passes their nodes in no particular order to <fn> with <arg> if <fn> is
+ * not NULL, for instance to free them. The subtree holding them is detached
+ * from the tree at once by eb_detach(), so it costs the same as deleting one
+ * node plus a walk over the deleted ones. Returns the number of deleted keys.
+ */
+static forceinline unsigned long __ebmb_delete_prefix(struct eb_root *root, const void *x, unsigned int len,
+                                                      void (*fn)(struct eb_node *node, void *arg), void *arg)
+{
+	return eb_detach(__ebmb_prefix_subtree(root, x, len), fn, arg);
+}
+
 /* Insert ebmb_node <new> into subtree starting at node root <root>.
  * Only new->key needs be set with the key. The ebmb_node is returned.
  * If root->b[EB_RGHT]==1, the tree may only contain unique keys. The
@@ -476,6 +609,140 @@ static forceinline struct ebmb_node *__ebmb_lookup_longest(struct eb_root *root,
 }
 
 
+/* Number of lookups interleaved by __ebmb_lookup_longest_batch() */
+#define EBMB_BATCH_LANES	8
+
+/* Returned by __ebmb_lookup_longest_step() when no prefix matches */
+#define EBMB_LANE_NONE	((struct ebmb_node *)1)
+
+/* State of one lookup in __ebmb_lookup_longest_batch() */
+struct ebmb_lane {
+	const unsigned char *x; /* current byte of the key */
+	eb_troot_t *troot;      /* next branch to visit */
+	eb_troot_t *cover;      /* last cover found, or NULL */
+	int pos;                /* number of bytes of the key already checked */
+	unsigned int idx;       /* index of the key in the batch */
+};
+
+/* Performs one step of __ebmb_lookup_longest() for lane <l>, and prefetches
+ * the next node it will visit. Returns NULL as long as the lookup is not
+ * complete. Otherwise the result is returned, or EBMB_LANE_NONE if no prefix
+ * matches.
+ */
+static forceinline struct ebmb_node *__ebmb_lookup_longest_step(struct ebmb_lane *l)
+{
+	struct ebmb_node *node;
+	eb_troot_t *troot = l->troot;
+	int node_bit, side;
+
+	if ((eb_gettag(troot) == EB_LEAF)) {
+		node = container_of(eb_untag(troot, EB_LEAF),
+				    struct ebmb_node, node.branches);
+		if (check_bits(l->x - l->pos, node->key, l->pos, node->node.pfx))
+			goto not_found;
+		return node;
+	}
+	node = container_of(eb_untag(troot, EB_NODE),
+			    struct ebmb_node, node.branches);
+
+	node_bit = node->node.bit;
+	if (node_bit < 0) {
+		/* dup tree, see __ebmb_lookup_longest() */
+		if (check_bits(l->x - l->pos, node->key, l->pos, node->node.pfx))
+			goto not_found;
+
+		troot = node->node.branches.b[EB_LEFT];
+		while (eb_gettag(troot) != EB_LEAF)
+			troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+		return container_of(eb_untag(troot, EB_LEAF),
+				    struct ebmb_node, node.branches);
+	}
+
+	node_bit >>= 1; /* strip cover bit */
+	node_bit = ~node_bit + (l->pos << 3) + 8; /* = (pos<<3) + (7 - node_bit) */
+	while (node_bit < 0) {
+		l->x++; l->pos++;
+		if (node->key[l->pos - 1] ^ l->x[-1])
+			goto not_found; /* more than one full byte is different */
+		node_bit += 8;
+	}
+
+	side = *l->x >> node_bit;
+	if (((node->key[l->pos] >> node_bit) ^ side) > 1)
+		goto not_found;
+
+	if (!(node->node.bit & 1)) {
+		/* cover node, the covered subtree is on the right */
+		l->cover = node->node.branches.b[EB_LEFT];
+		troot = node->node.branches.b[EB_RGHT];
+	}
+	else
+		troot = node->node.branches.b[side & 1];
+
+	__builtin_prefetch(troot);
+	l->troot = troot;
+	return NULL;
+
+ not_found:
+	if (!l->cover)
+		return EBMB_LANE_NONE;
+	return ebmb_entry(eb_walk_down(l->cover, EB_LEFT), struct ebmb_node, node);
+}
+
+/* Performs __ebmb_lookup_longest() on the <nb> keys found every <stride> bytes
+ * from <keys> in tree <root>, and stores the results in <res>. Up to
+ * EBMB_BATCH_LANES lookups are in progress at once, each one visiting one node
+ * in turn after having prefetched it, so that several cache misses are being
+ * resolved at the same time instead of one after the other. This is mostly
+ * useful on trees which do not fit in the CPU caches.
+ */
+static forceinline void __ebmb_lookup_longest_batch(struct eb_root *root, const void *keys, unsigned long stride,
+						    unsigned int nb, struct ebmb_node **res)
+{
+	struct ebmb_lane lanes[EBMB_BATCH_LANES];
+	struct ebmb_node *node;
+	unsigned int next, active, i;
+
+	if (unlikely(root->b[EB_LEFT] == NULL)) {
+		for (i = 0; i < nb; i++)
+			res[i] = NULL;
+		return;
+	}
+
+	__builtin_prefetch(root->b[EB_LEFT]);
+	for (next = active = 0; active < EBMB_BATCH_LANES && next < nb; active++, next++) {
+		lanes[active].x = (const unsigned char *)keys + next * stride;
+		lanes[active].troot = root->b[EB_LEFT];
+		lanes[active].cover = NULL;
+		lanes[active].pos = 0;
+		lanes[active].idx = next;
+	}
+
+	while (active) {
+		for (i = 0; i < active; ) {
+			node = __ebmb_lookup_longest_step(&lanes[i]);
+			if (!node) {
+				i++;
+				continue;
+			}
+			res[lanes[i].idx] = node == EBMB_LANE_NONE ? NULL : node;
+
+			if (next < nb) {
+				/* start the next lookup in this lane */
+				lanes[i].x = (const unsigned char *)keys + next * stride;
+				lanes[i].troot = root->b[EB_LEFT];
+				lanes[i].cover = NULL;
+				lanes[i].pos = 0;
+				lanes[i].idx = next++;
+				i++;
+			}
+			else
+				lanes[i] = lanes[--active];
+		}
+	}
+}
+
+
 /* Find the first occurence of a prefix matching a key <x> of <pfx> BITS in the
  * tree <root>. It's the caller's responsibility to ensure that key <x> is at
  * least as long as the keys in the tree. Note that this can be ensured by
@@ -815,6 +1082,255 @@ __ebmb_insert_prefix(struct eb_root *root, struct ebmb_node *new, unsigned int l
 }
 
 
+/* Word keys.
+ *
+ * Keys whose length is a multiple of 8 bytes (up to EBMB_W_MAX_LEN) may also be
+ * handled as arrays of big-endian 64-bit words. The probe is converted once to
+ * native words, after which a branch is picked with a single shift per node,
+ * and a difference is located with a single fls per word instead of walking
+ * over bytes. The tree is exactly the same as with the byte-oriented functions
+ * so both may be mixed on the same tree. Other lengths fall back to those,
+ * unless the length is known at build time, in which case the last word is
+ * only partially loaded and padded with zeroes.
+ */
+
+/* Longest key supported by the word functions, in bytes */
+#define EBMB_W_MAX_LEN	64
+
+/* Returns the 64-bit big-endian word at <p> in native order */
+static forceinline unsigned long long ebmb_w_load(const unsigned char *p)
+{
+	unsigned long long w;
+
+	__builtin_memcpy(&w, p, sizeof(w));
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+	w = __builtin_bswap64(w);
+#endif
+	return w;
+}
+
+/* Returns the first <n> bytes of the big-endian word at <p> in native order,
+ * padded with zeroes. <n> should be a constant for this to be efficient.
+ */
+static forceinline unsigned long long ebmb_w_load_n(const unsigned char *p, unsigned int n)
+{
+	unsigned long long w = 0;
+
+	if (n >= sizeof(w))
+		return ebmb_w_load(p);
+	__builtin_memcpy(&w, p, n);
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+	w = __builtin_bswap64(w);
+#endif
+	return w;
+}
+
+/* Returns non-zero if the word functions may be used for keys of <len> bytes */
+#define ebmb_w_usable(len)						\
+	((len) && (len) <= EBMB_W_MAX_LEN &&				\
+	 (!((len) & 7) || __builtin_constant_p(len)))
+
+/* Returns bit <pos> of the key stored as native words in <w> */
+static forceinline int ebmb_w_bit(const unsigned long long *w, unsigned int pos)
+{
+	return (w[pos >> 6] >> (~pos & 63)) & 1;
+}
+
+/* Returns the number of equal bits between the native words at <w> and the
+ * key of <size> bytes at <k>, from bit <ignore> which is known to be equal,
+ * up to bit <len>. As equal_bits(), it may return more than <len> bits when
+ * they all match.
+ */
+static forceinline int ebmb_w_equal_bits(const unsigned long long *w, const unsigned char *k,
+					 int ignore, int len, unsigned int size)
+{
+	unsigned long long d;
+	int i;
+
+	for (i = ignore >> 6; i << 6 < len; i++) {
+		d = w[i] ^ ebmb_w_load_n(k + (i << 3), size - (i << 3));
+		if (d)
+			return (i << 6) + 64 - fls64(d);
+	}
+	return i << 6;
+}
+
+/* Find the first occurence of a key of <len> bytes in the tree <root>, <len>
+ * being a multiple of 8 or a constant. If none can be found, return NULL.
+ */
+static forceinline struct ebmb_node *__ebmb_lookup_w(struct eb_root *root, const void *x, unsigned int len)
+{
+	unsigned long long w[EBMB_W_MAX_LEN / 8];
+	struct ebmb_node *node;
+	eb_troot_t *troot;
+	unsigned int i;
+	int node_bit;
+
+	if (!ebmb_w_usable(len))
+		return __ebmb_lookup(root, x, len);
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	for (i = 0; i < (len + 7) >> 3; i++)
+		w[i] = ebmb_w_load_n((const unsigned char *)x + (i << 3), len - (i << 3));
+
+	/* branches only depend on the key's bits, the key itself is only
+	 * checked once on the leaf or the duplicate tree we end up on.
+	 */
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebmb_node, node.branches);
+			break;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebmb_node, node.branches);
+		node_bit = node->node.bit;
+		if (node_bit < 0)
+			break;
+		troot = node->node.branches.b[ebmb_w_bit(w, node_bit)];
+	}
+
+	if (ebmb_w_equal_bits(w, node->key, 0, len << 3, len) < (int)(len << 3))
+		return NULL;
+
+	if (eb_gettag(troot) == EB_LEAF)
+		return node;
+
+	/* dup tree, return the first one */
+	troot = node->node.branches.b[EB_LEFT];
+	while (eb_gettag(troot) != EB_LEAF)
+		troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+	return container_of(eb_untag(troot, EB_LEAF),
+			    struct ebmb_node, node.branches);
+}
+
+/* Insert ebmb_node <new> into subtree starting at node root <root>, with
+ * the same semantics as __ebmb_insert(), <len> being a multiple of 8 or a
+ * constant.
+ */
+static forceinline struct ebmb_node *
+__ebmb_insert_w(struct eb_root *root, struct ebmb_node *new, unsigned int len)
+{
+	unsigned long long w[EBMB_W_MAX_LEN / 8];
+	struct ebmb_node *old;
+	unsigned int side, i;
+	eb_troot_t *troot, **up_ptr;
+	eb_troot_t *root_right;
+	int diff;
+	int bit;
+	eb_troot_t *new_left, *new_rght;
+	eb_troot_t *new_leaf;
+	int old_node_bit;
+
+	if (!ebmb_w_usable(len))
+		return __ebmb_insert(root, new, len);
+
+	side = EB_LEFT;
+	troot = root->b[EB_LEFT];
+	root_right = root->b[EB_RGHT];
+	if (unlikely(troot == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		root->b[EB_LEFT] = eb_dotag(&new->node.branches, EB_LEAF);
+		new->node.leaf_p = eb_dotag(root, EB_LEFT);
+		new->node.node_p = NULL; /* node part unused */
+		return new;
+	}
+
+	for (i = 0; i < (len + 7) >> 3; i++)
+		w[i] = ebmb_w_load_n(new->key + (i << 3), len - (i << 3));
+
+	/* same descent as __ebmb_insert() */
+	bit = 0;
+	while (1) {
+		if (unlikely(eb_gettag(troot) == EB_LEAF)) {
+			/* insert above a leaf */
+			old = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebmb_node, node.branches);
+			new->node.node_p = old->node.leaf_p;
+			up_ptr = &old->node.leaf_p;
+			goto check_bit_and_break;
+		}
+
+		/* OK we're walking down this link */
+		old = container_of(eb_untag(troot, EB_NODE),
+				   struct ebmb_node, node.branches);
+		old_node_bit = old->node.bit;
+
+		if (unlikely(old->node.bit < 0)) {
+			/* We're above a duplicate tree, so we must compare the whole value */
+			new->node.node_p = old->node.node_p;
+			up_ptr = &old->node.node_p;
+		check_bit_and_break:
+			bit = ebmb_w_equal_bits(w, old->key, bit, len << 3, len);
+			break;
+		}
+
+		bit = ebmb_w_equal_bits(w, old->key, bit, old_node_bit, len);
+		if (unlikely(bit < old_node_bit)) {
+			/* insert <new> before the node <old> */
+			new->node.node_p = old->node.node_p;
+			up_ptr = &old->node.node_p;
+			break;
+		}
+		bit = old_node_bit + 1;
+
+		/* walk down */
+		root = &old->node.branches;
+		side = ebmb_w_bit(w, old_node_bit);
+		troot = root->b[side];
+	}
+
+	new_left = eb_dotag(&new->node.branches, EB_LEFT);
+	new_rght = eb_dotag(&new->node.branches, EB_RGHT);
+	new_leaf = eb_dotag(&new->node.branches, EB_LEAF);
+
+	new->node.bit = bit;
+
+	/* the keys differ at bit <bit> unless it's past the end */
+	diff = 0;
+	if ((unsigned)bit < len << 3)
+		diff = ebmb_w_bit(w, bit) ? 1 : -1;
+
+	if (diff == 0) {
+		new->node.bit = -1; /* mark as new dup tree, just in case */
+
+		if (likely(eb_gettag(root_right))) {
+			/* we refuse to duplicate this key if the tree is
+			 * tagged as containing only unique keys.
+			 */
+			return old;
+		}
+
+		if (eb_gettag(troot) != EB_LEAF) {
+			/* there was already a dup tree below */
+			struct eb_node *ret;
+			ret = eb_insert_dup(&old->node, &new->node);
+			return container_of(ret, struct ebmb_node, node);
+		}
+		/* otherwise fall through */
+	}
+
+	if (diff >= 0) {
+		new->node.branches.b[EB_LEFT] = troot;
+		new->node.branches.b[EB_RGHT] = new_leaf;
+		new->node.leaf_p = new_rght;
+		*up_ptr = new_left;
+	}
+	else {
+		new->node.branches.b[EB_LEFT] = new_leaf;
+		new->node.branches.b[EB_RGHT] = troot;
+		new->node.leaf_p = new_left;
+		*up_ptr = new_rght;
+	}
+
+	root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+	return new;
+}
+
+
 
 #endif /* _EBMBTREE_H */
 
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ebmbtree.h"
+
+/* Inserts then looks up random keys of common fixed sizes, once with the
+ * generic functions taking the length at run time, and once with the
+ * functions specialized for this length, to measure the gain.
+ */
+
+typedef struct ebmb_node *(*lookup_f)(struct eb_root *, const void *);
+typedef struct ebmb_node *(*insert_f)(struct eb_root *, struct ebmb_node *);
+
+static const struct {
+	unsigned int len;
+	lookup_f lookup;
+	insert_f insert;
+} fixed[] = {
+	{  4, ebmb4_lookup,  ebmb4_insert  },
+	{  8, ebmb8_lookup,  ebmb8_insert  },
+	{ 16, ebmb16_lookup, ebmb16_insert },
+	{ 20, ebmb20_lookup, ebmb20_insert },
+	{ 32, ebmb32_lookup, ebmb32_insert },
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	struct eb_root root;
+	struct ebmb_node **nodes;
+	unsigned int seed = 1;
+	unsigned int len, f, j;
+	double t0, gins, glkp, fins, flkp;
+	int size, i, found;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s size\n", argv[0]);
+		exit(1);
+	}
+
+	size = atoi(argv[1]);
+	nodes = calloc(size, sizeof(*nodes));
+	if (!nodes)
+		exit(1);
+
+	for (i = 0; i < size; i++) {
+		nodes[i] = malloc(sizeof(*nodes[i]) + 32);
+		if (!nodes[i])
+			exit(1);
+		for (j = 0; j < 32; j++) {
+			seed = seed * 1103515245 + 12345;
+			nodes[i]->key[j] = seed >> 24;
+		}
+	}
+
+	for (f = 0; f < sizeof(fixed) / sizeof(fixed[0]); f++) {
+		len = fixed[f].len;
+
+		root = EB_ROOT_UNIQUE;
+		t0 = now();
+		for (i = 0; i < size; i++)
+			ebmb_insert(&root, nodes[i], len);
+		gins = now() - t0;
+
+		t0 = now();
+		for (found = i = 0; i < size; i++)
+			found += ebmb_lookup(&root, nodes[i]->key, len) == nodes[i];
+		glkp = now() - t0;
+
+		for (i = 0; i < size; i++)
+			ebmb_delete(nodes[i]);
+
+		root = EB_ROOT_UNIQUE;
+		t0 = now();
+		for (i = 0; i < size; i++)
+			fixed[f].insert(&root, nodes[i]);
+		fins = now() - t0;
+
+		t0 = now();
+		for (i = 0; i < size; i++)
+			found += fixed[f].lookup(&root, nodes[i]->key) == nodes[i];
+		flkp = now() - t0;
+
+		for (i = 0; i < size; i++)
+			ebmb_delete(nodes[i]);
+
+		/* 4-byte keys may collide on large sizes */
+		if (len > 4 && found != 2 * size)
+			fprintf(stderr, "only %d/%d keys found\n", found, 2 * size);
+
+		/* size, len, generic insert ns/key, generic lookup ns/key, fixed insert ns/key, fixed lookup ns/key */
+		printf("%d, %u, %.1f, %.1f, %.1f, %.1f\n", size, len,
+		       gins * 1e9 / size, glkp * 1e9 / size, fins * 1e9 / size, flkp * 1e9 / size);
+	}
+	return 0;
+}
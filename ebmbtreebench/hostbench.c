@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ebhntree.h"
+
+/* Matches host names against a domain block list, the way DNS filters and
+ * proxies do. Each domain blocks itself and all its subdomains. Names are
+ * looked up with ebhn_lookup_longest(), and compared to what is needed with
+ * names stored as is in an ebst tree : one ebst_lookup() per parent domain of
+ * the name, from the longest one. At least half of the names are subdomains of
+ * blocked domains.
+ */
+
+#define NAMES 1000000
+
+static const char *tlds[] = {
+	"com", "net", "org", "io", "info", "biz", "de", "ru", "co.uk", "com.br",
+	"xyz", "top", "cn", "fr", "jp", "online",
+};
+
+static const char *syll[] = {
+	"ad", "track", "cdn", "stat", "pix", "el", "media", "net", "go", "click",
+	"serv", "met", "ri", "ka", "lo", "zen", "tag", "sync", "web", "an",
+};
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* appends a random label to <p> and returns its new length */
+static int add_label(char *p, int len, int size)
+{
+	int n = 1 + rnd() % 3;
+
+	if (len)
+		len += snprintf(p + len, size - len, ".");
+	while (n--)
+		len += snprintf(p + len, size - len, "%s", syll[rnd() % 20]);
+	if (rnd() & 1)
+		len += snprintf(p + len, size - len, "%u", rnd() % 1000);
+	return len;
+}
+
+/* the matching without reversed keys */
+static struct ebmb_node *match_suffix(struct eb_root *root, const char *x)
+{
+	struct ebmb_node *node;
+
+	while (1) {
+		node = ebst_lookup(root, x);
+		if (node)
+			return node;
+		x = strchr(x, '.');
+		if (!x)
+			return NULL;
+		x++;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct eb_root hn = EB_ROOT_UNIQUE;
+	struct eb_root st = EB_ROOT_UNIQUE;
+	struct ebmb_node *node, *plain, **res, **found;
+	char **names, **domains;
+	double t0, lkh, lks;
+	int size, nb, i, len, bad, hits;
+	char name[256];
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s domains\n", argv[0]);
+		exit(1);
+	}
+
+	size = atoi(argv[1]);
+	domains = calloc(size, sizeof(*domains));
+	names = calloc(NAMES, sizeof(*names));
+	res = calloc(NAMES, sizeof(*res));
+	found = calloc(NAMES, sizeof(*found));
+	if (!domains || !names || !res || !found)
+		exit(1);
+
+	/* the list mixes registered domains and some of their subdomains */
+	for (nb = i = 0; i < size; i++) {
+		if (nb && rnd() % 4 == 0) {
+			len = add_label(name, 0, sizeof(name));
+			len += snprintf(name + len, sizeof(name) - len, ".%s", domains[rnd() % nb]);
+		}
+		else {
+			len = add_label(name, 0, sizeof(name));
+			len += snprintf(name + len, sizeof(name) - len, ".%s", tlds[rnd() % 16]);
+		}
+		if (len > EBHN_MAX_LEN)
+			continue;
+
+		node = malloc(sizeof(*node) + EBHN_KEY_SIZE(len));
+		plain = malloc(sizeof(*plain) + len + 1);
+		if (!node || !plain)
+			exit(1);
+		ebhn_encode((char *)node->key, name, len);
+		strcpy((char *)plain->key, name);
+		if (ebhn_insert(&hn, node) != node) {
+			free(node);
+			free(plain);
+			continue;
+		}
+		ebst_insert(&st, plain);
+		domains[nb++] = (char *)plain->key;
+	}
+
+	for (i = 0; i < NAMES; i++) {
+		len = add_label(name, 0, sizeof(name));
+		if (rnd() & 1) {
+			if (rnd() & 1)
+				len = add_label(name, len, sizeof(name));
+			snprintf(name + len, sizeof(name) - len, ".%s", domains[rnd() % nb]);
+		}
+		else
+			snprintf(name + len, sizeof(name) - len, ".%s", tlds[rnd() % 16]);
+		names[i] = strdup(name);
+		if (!names[i])
+			exit(1);
+	}
+
+	t0 = now();
+	for (i = 0; i < NAMES; i++)
+		res[i] = match_suffix(&st, names[i]);
+	lks = now() - t0;
+
+	t0 = now();
+	for (i = 0; i < NAMES; i++)
+		found[i] = ebhn_lookup_longest(&hn, names[i]);
+	lkh = now() - t0;
+
+	for (bad = hits = i = 0; i < NAMES; i++) {
+		if (!found[i] != !res[i])
+			bad++;
+		else if (found[i]) {
+			ebhn_decode(name, (const char *)found[i]->key);
+			bad += strcmp(name, (const char *)res[i]->key) != 0;
+			hits++;
+		}
+	}
+
+	if (bad)
+		fprintf(stderr, "%d/%d names matched differently\n", bad, NAMES);
+
+	/* domains, blocked names, ebst suffixes ns/name, ebhn ns/name */
+	printf("%d, %d, %.1f, %.1f\n", nb, hits, lks * 1e9 / NAMES, lkh * 1e9 / NAMES);
+	return bad != 0;
+}
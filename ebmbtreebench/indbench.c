@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ebistree.h"
+#include "ebisctree.h"
+
+/* Inserts then looks up indirect string keys in ebis and ebisc trees. The keys
+ * are stored in random order in a separate area, each in its own cache line,
+ * so that dereferencing a node's key is usually a cache miss, as in large
+ * string indexes.
+ */
+
+#define KEY_SLOT	64
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	struct eb_root rpt = EB_ROOT_UNIQUE, ric = EB_ROOT_UNIQUE;
+	struct ebpt_node *pt;
+	struct ebic_node *ic;
+	unsigned int *order;
+	char *keys, *key;
+	unsigned int seed = 1, tmp;
+	double t0, inspt, lkppt, insic, lkpic;
+	int size, i, j, found;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s size\n", argv[0]);
+		exit(1);
+	}
+
+	size = atoi(argv[1]);
+	keys  = calloc(size, KEY_SLOT);
+	order = calloc(size, sizeof(*order));
+	pt    = calloc(size, sizeof(*pt));
+	ic    = calloc(size, sizeof(*ic));
+	if (!keys || !order || !pt || !ic)
+		exit(1);
+
+	/* shuffle the key slots */
+	for (i = 0; i < size; i++)
+		order[i] = i;
+	for (i = size - 1; i > 0; i--) {
+		seed = seed * 1103515245 + 12345;
+		j = (seed >> 8) % (i + 1);
+		tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+	}
+
+	for (i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		key = keys + (size_t)order[i] * KEY_SLOT;
+		snprintf(key, KEY_SLOT, "%06x%d.%s.example.com", seed >> 8, i,
+			 (seed & 1) ? "static" : "www");
+		pt[i].key = ic[i].key = key;
+	}
+
+	t0 = now();
+	for (i = 0; i < size; i++)
+		ebis_insert(&rpt, &pt[i]);
+	inspt = now() - t0;
+
+	t0 = now();
+	for (found = i = 0; i < size; i++) {
+		j = (unsigned long)i * 7919 % size;
+		found += ebis_lookup(&rpt, pt[j].key) == &pt[j];
+	}
+	lkppt = now() - t0;
+
+	t0 = now();
+	for (i = 0; i < size; i++)
+		ebisc_insert(&ric, &ic[i]);
+	insic = now() - t0;
+
+	t0 = now();
+	for (i = 0; i < size; i++) {
+		j = (unsigned long)i * 7919 % size;
+		found += ebisc_lookup(&ric, ic[j].key) == &ic[j];
+	}
+	lkpic = now() - t0;
+
+	/* keys are unique, but 7919 must not divide size */
+	if (found != 2 * size)
+		fprintf(stderr, "only %d/%d keys found\n", found, 2 * size);
+
+	/* size, ebis insert ns/key, ebis lookup ns/key, ebisc insert ns/key, ebisc lookup ns/key */
+	printf("%d, %.1f, %.1f, %.1f, %.1f\n", size,
+	       inspt * 1e9 / size, lkppt * 1e9 / size, insic * 1e9 / size, lkpic * 1e9 / size);
+	return 0;
+}
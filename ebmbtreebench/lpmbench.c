@@ -0,0 +1,396 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ebmbtree.h"
+#include "eblpm.h"
+
+/* Loads a synthetic routing table with a BGP-like prefix length distribution
+ * into an ebmb prefix tree using ebmb_insert_prefix(), then measures
+ * ebmb_lookup_longest() throughput and per-lookup latency percentiles for two
+ * cases :
+ *   - hit     : addresses picked inside random routes of the table ;
+ *   - default : addresses matching no route but the default one (0/0).
+ * About 30% of the routes are more specifics of previously generated ones, as
+ * found in real tables where allocations are deaggregated. IPv6 routes are
+ * taken from 2000::/3. The latency is measured around each lookup, with the
+ * clock's own overhead removed, so it is only indicative for short lookups.
+ * Lookups are also performed in batches of 64 and 256 addresses using
+ * ebmb_lookup_longest_batch(), in which case the latency is the one of a whole
+ * batch divided by its size. The same routes are then loaded into an eblpm
+ * tree using a front table of <bits> bits (16 by default, -b to change) and
+ * measured the same way.
+ */
+
+/* a route, the address must immediately follow the node */
+struct route {
+	struct ebmb_node node;
+	unsigned char addr[16];
+};
+
+/* prefix length distributions, in routes per 100000, roughly following the
+ * public BGP tables.
+ */
+struct pfx_weight {
+	unsigned int len;
+	unsigned int weight;
+};
+
+static const struct pfx_weight v4_weights[] = {
+	{ 24, 59000 }, { 23, 10500 }, { 22, 12600 }, { 21, 4700 }, { 20, 4700 },
+	{ 19, 2600 }, { 18, 850 }, { 17, 530 }, { 16, 1370 }, { 15, 105 },
+	{ 14, 75 }, { 13, 42 }, { 12, 21 }, { 11, 9 }, { 10, 4 }, { 9, 2 },
+	{ 8, 2 }, { 0, 0 }
+};
+
+static const struct pfx_weight v6_weights[] = {
+	{ 48, 47000 }, { 32, 12000 }, { 44, 8500 }, { 40, 6000 }, { 46, 3000 },
+	{ 36, 2500 }, { 29, 2500 }, { 47, 2500 }, { 42, 1500 }, { 33, 1250 },
+	{ 34, 1250 }, { 45, 1000 }, { 35, 750 }, { 38, 750 }, { 28, 500 },
+	{ 56, 500 }, { 64, 200 }, { 24, 100 }, { 20, 20 }, { 0, 0 }
+};
+
+static unsigned long long seed = 0x9e3779b97f4a7c15ULL;
+
+/* xorshift64* */
+static unsigned long long rnd64(void)
+{
+	seed ^= seed >> 12;
+	seed ^= seed << 25;
+	seed ^= seed >> 27;
+	return seed * 2685821657736338717ULL;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/* Returns a random prefix length following distribution <w> */
+static unsigned int pick_len(const struct pfx_weight *w)
+{
+	unsigned int total, r, i;
+
+	for (total = i = 0; w[i].len; i++)
+		total += w[i].weight;
+	r = rnd64() % total;
+	for (i = 0; r >= w[i].weight; i++)
+		r -= w[i].weight;
+	return w[i].len;
+}
+
+/* Fills address <addr> of <len> bytes with random bits from bit <from> */
+static void rand_bits(unsigned char *addr, unsigned int len, unsigned int from)
+{
+	unsigned int i;
+
+	for (i = from / 8; i < len; i++) {
+		if (i == from / 8 && (from & 7))
+			addr[i] = (addr[i] & (0xff00 >> (from & 7))) | ((unsigned char)rnd64() & (0xff >> (from & 7)));
+		else
+			addr[i] = rnd64();
+	}
+}
+
+/* Clears all bits of address <addr> of <len> bytes starting at bit <from> */
+static void clear_bits(unsigned char *addr, unsigned int len, unsigned int from)
+{
+	unsigned int i;
+
+	for (i = from / 8; i < len; i++) {
+		if (i == from / 8 && (from & 7))
+			addr[i] &= 0xff00 >> (from & 7);
+		else
+			addr[i] = 0;
+	}
+}
+
+/* Returns a random global unicast address of <len> bytes in <addr> */
+static void rand_global(unsigned char *addr, unsigned int len)
+{
+	rand_bits(addr, len, 0);
+	if (len == 4) {
+		/* 1-223 except 10 and 127 */
+		do {
+			addr[0] = 1 + rnd64() % 223;
+		} while (addr[0] == 10 || addr[0] == 127);
+	}
+	else
+		addr[0] = 0x20 | (addr[0] & 0x1f);
+}
+
+/* Returns non-zero if the first <pfx> bits of <a> and <b> are equal */
+static int same_prefix(const unsigned char *a, const unsigned char *b, unsigned int pfx)
+{
+	if (memcmp(a, b, pfx / 8) != 0)
+		return 0;
+	if (!(pfx & 7))
+		return 1;
+	return !((a[pfx / 8] ^ b[pfx / 8]) & (0xff00 >> (pfx & 7)));
+}
+
+/* Returns the value at <pm> per mille of sorted array <lat> of <n> values */
+static unsigned long pct(const unsigned long *lat, int n, int pm)
+{
+	return lat[(unsigned long)n * pm / 1000];
+}
+
+static int cmp_ulong(const void *a, const void *b)
+{
+	unsigned long x = *(const unsigned long *)a, y = *(const unsigned long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static struct ebmb_node *lookup_ebmb(void *root, const void *x)
+{
+	return ebmb_lookup_longest(root, x);
+}
+
+static struct ebmb_node *lookup_eblpm(void *root, const void *x)
+{
+	return eblpm_lookup_longest(root, x);
+}
+
+/* Measures lookups of the <nb> addresses of <len> bytes from <probes> in tree
+ * <root> using <lookup>, and prints the results for tree <tree> and case <name>.
+ */
+static void bench(struct ebmb_node *(*lookup)(void *, const void *), void *root,
+		  const unsigned char *probes, unsigned int len, int nb, const char *family,
+		  int routes, const char *tree, const char *name, unsigned long *lat)
+{
+	struct ebmb_node *node;
+	unsigned long t, ovh, sum;
+	double t0, t1;
+	int i;
+
+	/* throughput */
+	sum = 0;
+	t0 = now();
+	for (i = 0; i < nb; i++) {
+		node = lookup(root, probes + (size_t)i * len);
+		sum += node->node.pfx;
+	}
+	t1 = now() - t0;
+
+	/* clock overhead */
+	for (i = 0; i < nb && i < 100000; i++) {
+		t = now_ns();
+		lat[i] = now_ns() - t;
+	}
+	qsort(lat, i, sizeof(*lat), cmp_ulong);
+	ovh = lat[i / 2];
+
+	/* latency */
+	for (i = 0; i < nb; i++) {
+		t = now_ns();
+		node = lookup(root, probes + (size_t)i * len);
+		lat[i] = now_ns() - t;
+		sum += node->node.pfx;
+		lat[i] = lat[i] > ovh ? lat[i] - ovh : 0;
+	}
+	qsort(lat, nb, sizeof(*lat), cmp_ulong);
+
+	/* family, routes, tree, case, Mlookups/s, p50 ns, p90 ns, p99 ns, p99.9 ns, checksum */
+	printf("%s, %d, %s, %s, %.2f, %lu, %lu, %lu, %lu, %lu\n", family, routes, tree, name,
+	       nb / t1 / 1e6, pct(lat, nb, 500), pct(lat, nb, 900), pct(lat, nb, 990),
+	       pct(lat, nb, 999), sum);
+}
+
+/* Same as bench() but using ebmb_lookup_longest_batch() on batches of <batch>
+ * addresses, whose results are compared with <expect> if not NULL.
+ */
+static void bench_batch(struct eb_root *root, const unsigned char *probes, unsigned int len, int nb,
+			int batch, struct ebmb_node **expect, const char *family, int routes,
+			const char *name, unsigned long *lat)
+{
+	struct ebmb_node **res;
+	unsigned long t, sum;
+	double t0, t1;
+	char tree[16];
+	int i, j, n, bad;
+
+	res = calloc(nb, sizeof(*res));
+	if (!res)
+		exit(1);
+
+	/* throughput */
+	t0 = now();
+	for (i = 0; i < nb; i += batch)
+		ebmb_lookup_longest_batch(root, probes + (size_t)i * len, len,
+					  nb - i < batch ? nb - i : batch, res + i);
+	t1 = now() - t0;
+
+	for (sum = bad = i = 0; i < nb; i++) {
+		sum += res[i]->node.pfx;
+		bad += expect && res[i] != expect[i];
+	}
+	if (bad)
+		fprintf(stderr, "%d/%d batched lookups differ\n", bad, nb);
+
+	/* latency per batch, amortized over its addresses */
+	for (j = i = 0; i < nb; i += batch, j++) {
+		n = nb - i < batch ? nb - i : batch;
+		t = now_ns();
+		ebmb_lookup_longest_batch(root, probes + (size_t)i * len, len, n, res + i);
+		lat[j] = (now_ns() - t) / n;
+	}
+	for (i = 0; i < nb; i++)
+		sum += res[i]->node.pfx;
+	qsort(lat, j, sizeof(*lat), cmp_ulong);
+
+	snprintf(tree, sizeof(tree), "ebmb-b%d", batch);
+	printf("%s, %d, %s, %s, %.2f, %lu, %lu, %lu, %lu, %lu\n", family, routes, tree, name,
+	       nb / t1 / 1e6, pct(lat, j, 500), pct(lat, j, 900), pct(lat, j, 990),
+	       pct(lat, j, 999), sum);
+	free(res);
+}
+
+int main(int argc, char **argv)
+{
+	struct eb_root root = EB_ROOT_UNIQUE;
+	struct eblpm_root lpm;
+	struct route *routes, *r, deflt;
+	struct ebmb_node *node, **expect;
+	const struct pfx_weight *weights;
+	unsigned char *hits, *dflts, *p;
+	unsigned long *lat;
+	unsigned int len, pfx, bits;
+	const char *family;
+	char name[16];
+	int size, nb, i, j, loaded, bad, tries;
+	double t0, tins;
+
+	len = 4;
+	bits = EBLPM_BITS;
+	while (argc > 1 && *argv[1] == '-') {
+		if (strcmp(argv[1], "-6") == 0)
+			len = 16;
+		else if (strcmp(argv[1], "-b") == 0 && argc > 2) {
+			bits = atoi(argv[2]);
+			argc--; argv++;
+		}
+		else
+			break;
+		argc--; argv++;
+	}
+
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "Usage: %s [-6] [-b bits] routes [lookups]\n", argv[0]);
+		exit(1);
+	}
+
+	size = atoi(argv[1]);
+	nb = argc > 2 ? atoi(argv[2]) : 1000000;
+	if (size <= 0 || nb <= 0)
+		exit(1);
+
+	family  = len == 4 ? "ipv4" : "ipv6";
+	weights = len == 4 ? v4_weights : v6_weights;
+	routes  = calloc(size, sizeof(*routes));
+	hits    = calloc(nb, len);
+	dflts   = calloc(nb, len);
+	lat     = calloc(nb, sizeof(*lat));
+	expect  = calloc(nb, sizeof(*expect));
+	if (!routes || !hits || !dflts || !lat || !expect)
+		exit(1);
+
+	/* build the routes, nesting some of them into earlier ones */
+	for (i = 0; i < size; i++) {
+		r = &routes[i];
+		pfx = pick_len(weights);
+		j = i ? rnd64() % i : 0;
+		if (i && rnd64() % 100 < 30 && routes[j].node.node.pfx < pfx) {
+			memcpy(r->addr, routes[j].addr, len);
+			rand_bits(r->addr, len, routes[j].node.node.pfx);
+		}
+		else
+			rand_global(r->addr, len);
+		clear_bits(r->addr, len, pfx);
+		r->node.node.pfx = pfx;
+	}
+
+	/* the default route matches everything not covered */
+	memset(&deflt, 0, sizeof(deflt));
+	ebmb_insert_prefix(&root, &deflt.node, len);
+
+	t0 = now();
+	for (loaded = i = 0; i < size; i++)
+		loaded += ebmb_insert_prefix(&root, &routes[i].node, len) == &routes[i].node;
+	tins = now() - t0;
+
+	printf("# %s: %d routes (%d distinct) loaded in %.1f ns/route\n",
+	       family, size, loaded, tins * 1e9 / size);
+
+	/* hit case : random hosts inside random routes */
+	for (bad = i = 0; i < nb; i++) {
+		r = &routes[rnd64() % size];
+		p = hits + (size_t)i * len;
+		memcpy(p, r->addr, len);
+		rand_bits(p, len, r->node.node.pfx);
+
+		/* the longest match must cover the address at least as precisely */
+		node = expect[i] = ebmb_lookup_longest(&root, p);
+		if (!node || node->node.pfx < r->node.node.pfx ||
+		    !same_prefix(node->key, p, node->node.pfx))
+			bad++;
+	}
+	if (bad)
+		fprintf(stderr, "%d/%d wrong matches\n", bad, nb);
+	bench(lookup_ebmb, &root, hits, len, nb, family, loaded, "ebmb", "hit", lat);
+	bench_batch(&root, hits, len, nb, 64, expect, family, loaded, "hit", lat);
+	bench_batch(&root, hits, len, nb, 256, expect, family, loaded, "hit", lat);
+
+	/* default case : random addresses only matching the default route */
+	for (bad = i = 0; i < nb; i++) {
+		p = dflts + (size_t)i * len;
+		tries = 0;
+		do {
+			rand_global(p, len);
+		} while (ebmb_lookup_longest(&root, p) != &deflt.node && ++tries < 100);
+		bad += tries == 100;
+	}
+	if (bad)
+		fprintf(stderr, "%d/%d addresses not on the default route\n", bad, nb);
+	bench(lookup_ebmb, &root, dflts, len, nb, family, loaded, "ebmb", "default", lat);
+	bench_batch(&root, dflts, len, nb, 64, NULL, family, loaded, "default", lat);
+	bench_batch(&root, dflts, len, nb, 256, NULL, family, loaded, "default", lat);
+
+	/* same routes in an eblpm tree */
+	if (!eblpm_init(&lpm, bits, 1))
+		exit(1);
+
+	for (i = 0; i < size; i++)
+		ebmb_delete(&routes[i].node);
+	ebmb_delete(&deflt.node);
+
+	t0 = now();
+	eblpm_insert_prefix(&lpm, &deflt.node, len);
+	for (i = 0; i < size; i++)
+		eblpm_insert_prefix(&lpm, &routes[i].node, len);
+	tins = now() - t0;
+
+	snprintf(name, sizeof(name), "eblpm%u", lpm.bits);
+	printf("# %s: %d routes loaded in %.1f ns/route into %s\n",
+	       family, size, tins * 1e9 / size, name);
+
+	for (bad = i = 0; i < nb; i++)
+		bad += eblpm_lookup_longest(&lpm, hits + (size_t)i * len) != expect[i];
+	if (bad)
+		fprintf(stderr, "%d/%d lookups differ\n", bad, nb);
+
+	bench(lookup_eblpm, &lpm, hits, len, nb, family, loaded, name, "hit", lat);
+	bench(lookup_eblpm, &lpm, dflts, len, nb, family, loaded, name, "default", lat);
+	return 0;
+}
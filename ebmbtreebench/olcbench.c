@@ -0,0 +1,135 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ebolc.h"
+
+/* Compares an ebolc tree with a single ebmb tree protected by a global mutex
+ * under a mix of lookups and updates from several threads. Each thread owns a
+ * slice of the nodes which it alternately deletes and re-inserts, and looks up
+ * random keys from the whole set.
+ */
+
+#define KEYLEN 8
+
+struct bnode {
+	struct ebmb_node node;
+	unsigned char key[KEYLEN];
+};
+
+static struct bnode *nodes;
+static int nbnodes, nbthreads, writepct, loops;
+static struct eb_root mroot = EB_ROOT;
+static pthread_mutex_t mlock = PTHREAD_MUTEX_INITIALIZER;
+static struct ebolc_root oroot;
+static int use_olc;
+static unsigned long found[64];
+
+static inline unsigned int rnd(unsigned int *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return *seed;
+}
+
+static void *worker(void *arg)
+{
+	int tid = (long)arg;
+	int slice = nbnodes / nbthreads;
+	unsigned int seed = tid * 2654435761U + 1;
+	struct bnode *n;
+	int i;
+
+	for (i = 0; i < loops; i++) {
+		if ((int)(rnd(&seed) % 100) < writepct) {
+			n = &nodes[tid * slice + rnd(&seed) % slice];
+			if (use_olc) {
+				ebolc_delete(&oroot, &n->node);
+				ebolc_insert(&oroot, &n->node, KEYLEN);
+			} else {
+				pthread_mutex_lock(&mlock);
+				ebmb_delete(&n->node);
+				ebmb_insert(&mroot, &n->node, KEYLEN);
+				pthread_mutex_unlock(&mlock);
+			}
+		} else {
+			n = &nodes[rnd(&seed) % nbnodes];
+			if (use_olc) {
+				if (ebolc_lookup(&oroot, n->key, KEYLEN))
+					found[tid]++;
+			} else {
+				pthread_mutex_lock(&mlock);
+				if (ebmb_lookup(&mroot, n->key, KEYLEN))
+					found[tid]++;
+				pthread_mutex_unlock(&mlock);
+			}
+		}
+	}
+	return NULL;
+}
+
+static double run(int olc)
+{
+	pthread_t thr[64];
+	struct timespec t0, t1;
+	long i;
+
+	use_olc = olc;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < nbthreads; i++)
+		pthread_create(&thr[i], NULL, worker, (void *)i);
+	for (i = 0; i < nbthreads; i++)
+		pthread_join(thr[i], NULL);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int seed = 1;
+	double mtime, otime;
+	int i, j;
+
+	if (argc != 5) {
+		fprintf(stderr, "Usage: %s threads nodes write%% loops\n", argv[0]);
+		exit(1);
+	}
+
+	nbthreads = atoi(argv[1]);
+	nbnodes   = atoi(argv[2]);
+	writepct  = atoi(argv[3]);
+	loops     = atoi(argv[4]);
+	if (nbthreads < 1 || nbthreads > 64 || nbnodes < nbthreads) {
+		fprintf(stderr, "threads must be within 1..64 and no more than nodes\n");
+		exit(1);
+	}
+
+	nodes = calloc(nbnodes, sizeof(*nodes));
+	if (!nodes || !ebolc_init(&oroot, EBOLC_BITS, 1)) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	/* distinct random keys, each node lives in one tree at a time */
+	for (i = 0; i < nbnodes; i++) {
+		for (j = 0; j < KEYLEN; j++)
+			nodes[i].key[j] = rnd(&seed);
+		while (ebmb_insert(&mroot, &nodes[i].node, KEYLEN) != &nodes[i].node)
+			nodes[i].key[KEYLEN - 1]++;
+	}
+	mtime = run(0);
+
+	for (i = 0; i < nbnodes; i++) {
+		ebmb_delete(&nodes[i].node);
+		ebolc_insert(&oroot, &nodes[i].node, KEYLEN);
+	}
+	otime = run(1);
+
+	/* threads, nodes, write%, mutex Mops/s, olc Mops/s */
+	printf("%d, %d, %d, %.3f, %.3f\n", nbthreads, nbnodes, writepct,
+	       (double)nbthreads * loops / mtime / 1e6,
+	       (double)nbthreads * loops / otime / 1e6);
+	return 0;
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "eb16tree.h"
+#include "eb32tree.h"
+
+/* Inserts then looks up port-like 16-bit keys in eb16 and eb32 trees, with
+ * the nodes embedded in a small structure carrying one extra 16-bit field as
+ * is commonly done for connections or small-ID indexes. Keys may repeat when
+ * more than 65536 entries are used, which results in duplicates.
+ */
+
+struct entry16 {
+	struct eb16_node node;
+	unsigned short id;
+};
+
+struct entry32 {
+	struct eb32_node node;
+	unsigned short id;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	struct eb_root root16 = EB_ROOT, root32 = EB_ROOT;
+	struct entry16 *e16;
+	struct entry32 *e32;
+	unsigned short *keys;
+	unsigned int seed = 1;
+	double t0, ins16, lkp16, ins32, lkp32;
+	int size, i, found;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s size\n", argv[0]);
+		exit(1);
+	}
+
+	size = atoi(argv[1]);
+	keys = calloc(size, sizeof(*keys));
+	e16 = calloc(size, sizeof(*e16));
+	e32 = calloc(size, sizeof(*e32));
+	if (!keys || !e16 || !e32)
+		exit(1);
+
+	for (i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		keys[i] = seed >> 16;
+		e16[i].node.key = e32[i].node.key = keys[i];
+		e16[i].id = e32[i].id = i;
+	}
+
+	t0 = now();
+	for (i = 0; i < size; i++)
+		eb16_insert(&root16, &e16[i].node);
+	ins16 = now() - t0;
+
+	t0 = now();
+	for (found = i = 0; i < size; i++)
+		found += eb16_lookup(&root16, keys[i]) != NULL;
+	lkp16 = now() - t0;
+
+	t0 = now();
+	for (i = 0; i < size; i++)
+		eb32_insert(&root32, &e32[i].node);
+	ins32 = now() - t0;
+
+	t0 = now();
+	for (i = 0; i < size; i++)
+		found += eb32_lookup(&root32, keys[i]) != NULL;
+	lkp32 = now() - t0;
+
+	if (found != 2 * size)
+		fprintf(stderr, "only %d/%d keys found\n", found, 2 * size);
+
+	/* size, entry16 bytes, insert16 ns/key, lookup16 ns/key, entry32 bytes, insert32 ns/key, lookup32 ns/key */
+	printf("%d, %d, %.1f, %.1f, %d, %.1f, %.1f\n", size,
+	       (int)sizeof(*e16), ins16 * 1e9 / size, lkp16 * 1e9 / size,
+	       (int)sizeof(*e32), ins32 * 1e9 / size, lkp32 * 1e9 / size);
+	return 0;
+}
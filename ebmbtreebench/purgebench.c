@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ebsttree.h"
+
+/* Purges half of a tree of URL-like keys, those below one of two top-level
+ * directories, either at once with ebst_delete_prefix() or by walking a
+ * prefix cursor and deleting each node it returns, such as when a cache
+ * invalidates a whole directory.
+ */
+
+static const char *dirs[] = {
+	"http://www.example.com/static/",
+	"http://www.example.com/videos/",
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void count_node(struct eb_node *node, void *arg)
+{
+	(void)node;
+	(*(unsigned long *)arg)++;
+}
+
+/* inserts the <size> nodes of <nodes> into <root> */
+static void fill(struct eb_root *root, struct ebmb_node **nodes, int size)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		ebst_insert(root, nodes[i]);
+}
+
+int main(int argc, char **argv)
+{
+	struct eb_root root;
+	struct ebmb_node **nodes, *node;
+	struct eb_cursor cur;
+	unsigned long calls, purged, walked;
+	unsigned int seed = 1;
+	double t0, prg, crs;
+	int size, i;
+	char url[256];
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s size\n", argv[0]);
+		exit(1);
+	}
+
+	size = atoi(argv[1]);
+	nodes = calloc(size, sizeof(*nodes));
+	if (!nodes)
+		exit(1);
+
+	for (i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		snprintf(url, sizeof(url), "%scategory-%03u/item-%08u.jpg",
+			 dirs[i & 1], (seed >> 8) % 200, i);
+		nodes[i] = malloc(sizeof(*nodes[i]) + strlen(url) + 1);
+		if (!nodes[i])
+			exit(1);
+		strcpy((char *)nodes[i]->key, url);
+	}
+
+	root = (struct eb_root)EB_ROOT_UNIQUE;
+	fill(&root, nodes, size);
+	calls = 0;
+	t0 = now();
+	purged = ebst_delete_prefix(&root, dirs[0], strlen(dirs[0]), count_node, &calls);
+	prg = now() - t0;
+
+	root = (struct eb_root)EB_ROOT_UNIQUE;
+	fill(&root, nodes, size);
+	walked = 0;
+	t0 = now();
+	ebst_prefix_cursor(&root, dirs[0], strlen(dirs[0]), 0, &cur);
+	while ((node = ebmb_cursor_next(&cur))) {
+		ebmb_delete(node);
+		walked++;
+	}
+	crs = now() - t0;
+
+	if (purged != calls || purged != walked || purged != (unsigned long)(size + 1) / 2)
+		fprintf(stderr, "purged %lu/%lu keys, walked %lu\n", purged, calls, walked);
+
+	/* size, purged keys, delete_prefix seconds, cursor walk seconds */
+	printf("%d, %lu, %.3f, %.3f\n", size, purged, prg, crs);
+	return 0;
+}
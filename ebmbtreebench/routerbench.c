@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ebsttree.h"
+#include "ebistree.h"
+
+/* Routes request paths to the longest registered path prefix, as done by URL
+ * routers and reverse proxies. All routes end with a slash so that they may
+ * only match whole segments. Each request is looked up in an ebst and an ebis
+ * tree with ebst_lookup_longest() and ebis_lookup_longest(), and compared to
+ * what is needed without them : one ebst_lookup_len() per slash of the path,
+ * from the longest one. 10% of the requests match no route.
+ */
+
+#define REQUESTS 1000000
+
+static const char *words[] = {
+	"api", "v1", "v2", "users", "orders", "accounts", "static", "assets",
+	"images", "admin", "search", "items", "catalog", "products", "cart",
+	"checkout", "blog", "posts", "comments", "media", "download", "docs",
+	"reports", "settings",
+};
+
+#define WORDS (sizeof(words) / sizeof(words[0]))
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* writes a random path of 1 to 5 segments ending with a slash into <p>. Some
+ * segments are numbered to get large route tables.
+ */
+static void make_route(char *p, int size)
+{
+	int depth = 1 + rnd() % 5;
+	int len = 0;
+
+	while (depth--) {
+		if (rnd() % 3)
+			len += snprintf(p + len, size - len, "/%s", words[rnd() % WORDS]);
+		else
+			len += snprintf(p + len, size - len, "/%s-%u", words[rnd() % WORDS], rnd() % 1000);
+	}
+	snprintf(p + len, size - len, "/");
+}
+
+/* the routing without ebst_lookup_longest() */
+static struct ebmb_node *route_len(struct eb_root *root, const char *x)
+{
+	struct ebmb_node *node;
+	int len = strlen(x);
+
+	while (len > 0) {
+		if (x[len - 1] == '/') {
+			node = ebst_lookup_len(root, x, len);
+			if (node)
+				return node;
+		}
+		len--;
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	struct eb_root st = EB_ROOT_UNIQUE;
+	struct eb_root is = EB_ROOT_UNIQUE;
+	struct ebmb_node *mb, **res;
+	struct ebpt_node *pt;
+	char **reqs, **routes;
+	double t0, lgs, lgi, lkl;
+	int size, nb, i, bad, miss;
+	char path[256];
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s routes\n", argv[0]);
+		exit(1);
+	}
+
+	size = atoi(argv[1]);
+	routes = calloc(size, sizeof(*routes));
+	reqs = calloc(REQUESTS, sizeof(*reqs));
+	res = calloc(REQUESTS, sizeof(*res));
+	if (!routes || !reqs || !res)
+		exit(1);
+
+	for (nb = i = 0; i < size; i++) {
+		make_route(path, sizeof(path));
+		mb = malloc(sizeof(*mb) + strlen(path) + 1);
+		pt = malloc(sizeof(*pt));
+		if (!mb || !pt)
+			exit(1);
+		strcpy((char *)mb->key, path);
+		if (ebst_insert(&st, mb) != mb) {
+			free(mb);
+			free(pt);
+			continue;
+		}
+		pt->key = mb->key;
+		ebis_insert(&is, pt);
+		routes[nb++] = (char *)mb->key;
+	}
+
+	/* requests extend a route with a few segments and sometimes a query
+	 * string, or start with an unknown segment.
+	 */
+	for (i = 0; i < REQUESTS; i++) {
+		int len;
+
+		if (rnd() % 10)
+			len = snprintf(path, sizeof(path), "%s", routes[rnd() % nb]);
+		else
+			len = snprintf(path, sizeof(path), "/unknown-%u/", rnd() % 1000);
+		len += snprintf(path + len, sizeof(path) - len, "%s-%u", words[rnd() % WORDS], rnd());
+		if (rnd() & 1)
+			len += snprintf(path + len, sizeof(path) - len, "/%u", rnd() % 100000);
+		if (rnd() & 1)
+			snprintf(path + len, sizeof(path) - len, "?id=%u&sort=asc", rnd());
+		reqs[i] = strdup(path);
+		if (!reqs[i])
+			exit(1);
+	}
+
+	t0 = now();
+	for (i = 0; i < REQUESTS; i++)
+		res[i] = route_len(&st, reqs[i]);
+	lkl = now() - t0;
+
+	bad = miss = 0;
+	t0 = now();
+	for (i = 0; i < REQUESTS; i++) {
+		mb = ebst_lookup_longest(&st, reqs[i]);
+		bad += mb != res[i];
+	}
+	lgs = now() - t0;
+
+	t0 = now();
+	for (i = 0; i < REQUESTS; i++) {
+		pt = ebis_lookup_longest(&is, reqs[i]);
+		bad += (pt ? pt->key : NULL) != (res[i] ? res[i]->key : NULL);
+		miss += !pt;
+	}
+	lgi = now() - t0;
+
+	if (bad)
+		fprintf(stderr, "%d/%d requests routed differently\n", bad, 2 * REQUESTS);
+
+	/* routes, unrouted requests, lookup_len ns/req, ebst longest ns/req, ebis longest ns/req */
+	printf("%d, %d, %.1f, %.1f, %.1f\n", nb, miss,
+	       lkl * 1e9 / REQUESTS, lgs * 1e9 / REQUESTS, lgi * 1e9 / REQUESTS);
+	return bad != 0;
+}
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ebsttree.h"
+
+/* Inserts then looks up URL-like keys sharing long prefixes, as found in
+ * proxy logs, or host names sharing shorter prefixes, to measure the cost of
+ * string comparisons in ebst trees.
+ */
+
+static const char *prefixes[] = {
+	"http://www.example.com/static/assets/images/catalog/products/",
+	"http://cdn.example.net/content/videos/2015/segments/hls/1080p/",
+	"https://api.example.org/v2/accounts/customers/orders/history/",
+	"http://download.example.com/pub/mirrors/distributions/packages/",
+};
+
+static const char *hostfmt[] = {
+	"www.shop-%u.example.com",
+	"cdn-%u.edge.provider.net",
+	"mail%u.corp.example.org",
+	"node-%u.cluster.internal",
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	struct eb_root root = EB_ROOT_UNIQUE;
+	struct ebmb_node **nodes;
+	unsigned int seed = 1;
+	double t0, ins, lkp, lkl;
+	int size, i, found, hosts;
+	char url[256];
+
+	if (argc < 2 || argc > 3 ||
+	    (argc == 3 && strcmp(argv[2], "urls") != 0 && strcmp(argv[2], "hosts") != 0)) {
+		fprintf(stderr, "Usage: %s size [urls|hosts]\n", argv[0]);
+		exit(1);
+	}
+
+	size = atoi(argv[1]);
+	hosts = argc == 3 && strcmp(argv[2], "hosts") == 0;
+	nodes = calloc(size, sizeof(*nodes));
+	if (!nodes)
+		exit(1);
+
+	for (i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		if (hosts)
+			snprintf(url, sizeof(url), hostfmt[(seed >> 16) & 3], i);
+		else
+			snprintf(url, sizeof(url), "%scategory-%03u/item-%08u.jpg?v=%u",
+				 prefixes[(seed >> 16) & 3], (seed >> 8) % 200, i, seed % 10);
+		nodes[i] = malloc(sizeof(*nodes[i]) + strlen(url) + 1);
+		if (!nodes[i])
+			exit(1);
+		strcpy((char *)nodes[i]->key, url);
+	}
+
+	t0 = now();
+	for (i = 0; i < size; i++)
+		ebst_insert(&root, nodes[i]);
+	ins = now() - t0;
+
+	t0 = now();
+	for (found = i = 0; i < size; i++)
+		found += ebst_lookup(&root, (const char *)nodes[i]->key) == nodes[i];
+	lkp = now() - t0;
+
+	t0 = now();
+	for (i = 0; i < size; i++)
+		found += ebst_lookup_len(&root, (const char *)nodes[i]->key,
+					 strlen((const char *)nodes[i]->key)) == nodes[i];
+	lkl = now() - t0;
+
+	if (found != 2 * size)
+		fprintf(stderr, "only %d/%d keys found\n", found, 2 * size);
+
+	/* size, insert ns/key, lookup ns/key, lookup_len ns/key */
+	printf("%d, %.1f, %.1f, %.1f\n", size, ins * 1e9 / size, lkp * 1e9 / size, lkl * 1e9 / size);
+	return 0;
+}
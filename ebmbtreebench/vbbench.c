@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ebmbtree.h"
+#include "ebvbtree.h"
+
+/* Stores protobuf-encoded identifiers, which are variable-length binary keys
+ * often holding zeroes, in an ebvb tree, and compares it to what is needed
+ * with an ebmb tree : keys padded with zeroes to the longest length, followed
+ * by their length so that "ab" and "ab\0" remain different keys and sort in
+ * the same order. Both trees are filled, then looked up with keys of which
+ * half are present, then with ebvb_lookup_ge() and a walk along the padded
+ * keys.
+ */
+
+#define LOOKUPS 1000000
+#define MAXLEN  24
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* writes a message of 1 to 4 fields to <p> and returns its length, which
+ * never exceeds MAXLEN. Fields are either varints or fixed32 little endian
+ * integers, which are small and thus hold zeroes.
+ */
+static int make_key(unsigned char *p)
+{
+	int fields = 1 + rnd() % 4;
+	int len = 0;
+	unsigned int v;
+
+	while (fields--) {
+		if (rnd() & 1) {
+			p[len++] = (1 + rnd() % 4) << 3;
+			v = rnd() >> (rnd() % 32);
+			while (v >= 0x80) {
+				p[len++] = v | 0x80;
+				v >>= 7;
+			}
+			p[len++] = v;
+		}
+		else {
+			p[len++] = ((5 + rnd() % 4) << 3) | 5;
+			v = rnd() % 1000;
+			memcpy(p + len, "\0\0\0\0", 4);
+			p[len++] = v;
+			p[len++] = v >> 8;
+			len += 2;
+		}
+	}
+	return len;
+}
+
+/* pads the <len> bytes key <k> to MAXLEN + 1 bytes into <p> */
+static void pad_key(unsigned char *p, const unsigned char *k, int len)
+{
+	memcpy(p, k, len);
+	memset(p + len, 0, MAXLEN - len);
+	p[MAXLEN] = len;
+}
+
+/* returns the position of the first of the <nb> sorted padded keys <keys>
+ * which is not lower than <key>, or <nb> if there is none.
+ */
+static int lower_bound(unsigned char **keys, int nb, const unsigned char *key)
+{
+	int lo = 0, hi = nb, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (memcmp(keys[mid], key, MAXLEN + 1) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+int main(int argc, char **argv)
+{
+	struct eb_root vb = EB_ROOT_UNIQUE;
+	struct eb_root mb = EB_ROOT_UNIQUE;
+	struct ebvb_node **vnodes, *vnode, **vres;
+	struct ebmb_node **mnodes, *mnode, **mres;
+	unsigned char **reqs, **sorted;
+	double t0, insv, insm, lkv, lkm, gev;
+	unsigned long mem;
+	int size, nb, i, len, bad, hits;
+	unsigned char key[MAXLEN + 1];
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s keys\n", argv[0]);
+		exit(1);
+	}
+
+	size = atoi(argv[1]);
+	vnodes = calloc(size, sizeof(*vnodes));
+	mnodes = calloc(size, sizeof(*mnodes));
+	sorted = calloc(size, sizeof(*sorted));
+	reqs = calloc(LOOKUPS, sizeof(*reqs));
+	vres = calloc(LOOKUPS, sizeof(*vres));
+	mres = calloc(LOOKUPS, sizeof(*mres));
+	if (!vnodes || !mnodes || !sorted || !reqs || !vres || !mres)
+		exit(1);
+
+	for (i = 0; i < size; i++) {
+		len = make_key(key);
+		vnodes[i] = malloc(sizeof(*vnode) + len);
+		mnodes[i] = malloc(sizeof(*mnode) + MAXLEN + 1);
+		if (!vnodes[i] || !mnodes[i])
+			exit(1);
+		vnodes[i]->len = len;
+		memcpy(vnodes[i]->key, key, len);
+		pad_key(mnodes[i]->key, key, len);
+	}
+
+	/* both trees refuse the same duplicates */
+	t0 = now();
+	for (i = 0; i < size; i++)
+		ebmb_insert(&mb, mnodes[i], MAXLEN + 1);
+	insm = now() - t0;
+
+	t0 = now();
+	for (i = 0; i < size; i++)
+		ebvb_insert(&vb, vnodes[i]);
+	insv = now() - t0;
+
+	mem = 0;
+	for (nb = 0, vnode = ebvb_first(&vb); vnode; vnode = ebvb_next(vnode), nb++)
+		mem += sizeof(*vnode) + vnode->len;
+	for (i = 0, mnode = ebmb_first(&mb); mnode; mnode = ebmb_next(mnode), i++)
+		sorted[i] = mnode->key;
+
+	/* half of the requests are stored keys */
+	for (i = 0; i < LOOKUPS; i++) {
+		reqs[i] = malloc(MAXLEN + 1);
+		if (!reqs[i])
+			exit(1);
+		if (rnd() & 1) {
+			vnode = vnodes[rnd() % size];
+			reqs[i][0] = vnode->len;
+			memcpy(reqs[i] + 1, vnode->key, vnode->len);
+		}
+		else
+			reqs[i][0] = make_key(reqs[i] + 1);
+	}
+
+	t0 = now();
+	for (i = 0; i < LOOKUPS; i++) {
+		pad_key(key, reqs[i] + 1, reqs[i][0]);
+		mres[i] = ebmb_lookup(&mb, key, MAXLEN + 1);
+	}
+	lkm = now() - t0;
+
+	t0 = now();
+	for (i = 0; i < LOOKUPS; i++)
+		vres[i] = ebvb_lookup(&vb, reqs[i] + 1, reqs[i][0]);
+	lkv = now() - t0;
+
+	for (bad = hits = i = 0; i < LOOKUPS; i++) {
+		if (!vres[i] != !mres[i])
+			bad++;
+		else if (vres[i]) {
+			pad_key(key, vres[i]->key, vres[i]->len);
+			bad += memcmp(key, mres[i]->key, MAXLEN + 1) != 0;
+			hits++;
+		}
+	}
+
+	/* ebmb has no lookup_ge(), results are checked on the sorted keys */
+	t0 = now();
+	for (i = 0; i < LOOKUPS; i++)
+		vres[i] = ebvb_lookup_ge(&vb, reqs[i] + 1, reqs[i][0]);
+	gev = now() - t0;
+
+	for (i = 0; i < LOOKUPS; i++) {
+		pad_key(key, reqs[i] + 1, reqs[i][0]);
+		len = lower_bound(sorted, nb, key);
+		if (len == nb)
+			bad += vres[i] != NULL;
+		else if (!vres[i])
+			bad++;
+		else {
+			pad_key(key, vres[i]->key, vres[i]->len);
+			bad += memcmp(key, sorted[len], MAXLEN + 1) != 0;
+		}
+	}
+
+	if (bad)
+		fprintf(stderr, "%d/%d keys matched differently\n", bad, 2 * LOOKUPS);
+
+	/* keys, hits, ebmb/ebvb bytes/node, ebmb/ebvb insert ns/key,
+	 * ebmb/ebvb lookup ns/key, ebvb lookup_ge ns/key
+	 */
+	printf("%d, %d, %lu, %lu, %.1f, %.1f, %.1f, %.1f, %.1f\n", nb, hits,
+	       (unsigned long)sizeof(*mnode) + MAXLEN + 1, mem / nb,
+	       insm * 1e9 / size, insv * 1e9 / size,
+	       lkm * 1e9 / LOOKUPS, lkv * 1e9 / LOOKUPS, gev * 1e9 / LOOKUPS);
+	return bad != 0;
+}
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ebmbtree.h"
+
+/* Inserts then looks up random keys whose length is a multiple of 8, once
+ * with the byte functions, and once with the functions processing keys as
+ * 64-bit words, to measure the gain.
+ */
+
+static const unsigned int lens[] = { 8, 16, 32, 64 };
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	struct eb_root root;
+	struct ebmb_node **nodes;
+	unsigned int seed = 1;
+	unsigned int len, l, j;
+	double t0, bins, blkp, wins, wlkp;
+	int size, i, found;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s size\n", argv[0]);
+		exit(1);
+	}
+
+	size = atoi(argv[1]);
+	nodes = calloc(size, sizeof(*nodes));
+	if (!nodes)
+		exit(1);
+
+	for (i = 0; i < size; i++) {
+		nodes[i] = malloc(sizeof(*nodes[i]) + 64);
+		if (!nodes[i])
+			exit(1);
+		for (j = 0; j < 64; j++) {
+			seed = seed * 1103515245 + 12345;
+			nodes[i]->key[j] = seed >> 24;
+		}
+	}
+
+	for (l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+		len = lens[l];
+
+		root = EB_ROOT_UNIQUE;
+		t0 = now();
+		for (i = 0; i < size; i++)
+			ebmb_insert(&root, nodes[i], len);
+		bins = now() - t0;
+
+		t0 = now();
+		for (found = i = 0; i < size; i++)
+			found += ebmb_lookup(&root, nodes[i]->key, len) == nodes[i];
+		blkp = now() - t0;
+
+		for (i = 0; i < size; i++)
+			ebmb_delete(nodes[i]);
+
+		root = EB_ROOT_UNIQUE;
+		t0 = now();
+		for (i = 0; i < size; i++)
+			ebmb_insert_w(&root, nodes[i], len);
+		wins = now() - t0;
+
+		t0 = now();
+		for (i = 0; i < size; i++)
+			found += ebmb_lookup_w(&root, nodes[i]->key, len) == nodes[i];
+		wlkp = now() - t0;
+
+		for (i = 0; i < size; i++)
+			ebmb_delete(nodes[i]);
+
+		if (found != 2 * size)
+			fprintf(stderr, "only %d/%d keys found\n", found, 2 * size);
+
+		/* size, len, byte insert ns/key, byte lookup ns/key, word insert ns/key, word lookup ns/key */
+		printf("%d, %u, %.1f, %.1f, %.1f, %.1f\n", size, len,
+		       bins * 1e9 / size, blkp * 1e9 / size, wins * 1e9 / size, wlkp * 1e9 / size);
+	}
+	return 0;
+}
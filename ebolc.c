@@ -0,0 +1,179 @@
+/*
+ * Elastic Binary Trees - optimistically locked Multi-Byte trees.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebolc.h for more details about those functions */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ebolc.h"
+
+/* Returned by ebolc_walk() when it notices it is walking over a stripe which
+ * is being modified.
+ */
+#define EBOLC_RETRY	((struct ebmb_node *)1)
+
+/* Number of nodes visited before a reader checks that it is not lost in a
+ * stripe which keeps being modified.
+ */
+#define EBOLC_CHECK_STEPS	64
+
+/* Initializes tree <root> to use 2^<bits> stripes (at most 16 bits). <unique>
+ * indicates whether duplicate keys are refused. Returns non-zero on success or
+ * zero if memory could not be allocated.
+ */
+int ebolc_init(struct ebolc_root *root, unsigned int bits, int unique)
+{
+	unsigned int i;
+
+	if (bits > 16)
+		bits = 16;
+
+	root->bits = bits;
+	root->stripes = NULL;
+	if (posix_memalign((void **)&root->stripes, sizeof(*root->stripes),
+			   sizeof(*root->stripes) << bits) != 0)
+		return 0;
+
+	for (i = 0; i < (1U << bits); i++) {
+		root->stripes[i].version = 0;
+		root->stripes[i].root = unique ? (struct eb_root)EB_ROOT_UNIQUE : (struct eb_root)EB_ROOT;
+	}
+	return 1;
+}
+
+/* Releases the stripes of tree <root>. The nodes are not touched. */
+void ebolc_destroy(struct ebolc_root *root)
+{
+	free(root->stripes);
+	root->stripes = NULL;
+}
+
+/* Looks up key <x> of <len> bytes in stripe <s> which had version <v> when the
+ * walk started. This is a plain walk down the tree which only checks the key
+ * once on the leaf. Since the stripe may be modified under us, we may read
+ * stale or half-updated nodes, so we never trust anything we find : branches
+ * may be NULL, bit positions may be out of range and paths may even loop. Any
+ * such inconsistency, as well as a modification noticed every few nodes,
+ * returns EBOLC_RETRY. Otherwise the caller still has to validate the result.
+ */
+static struct ebmb_node *ebolc_walk(const struct ebolc_stripe *s, unsigned long v,
+                                    const unsigned char *x, unsigned int len)
+{
+	struct ebmb_node *node;
+	eb_troot_t *troot;
+	unsigned int steps = 0;
+	int node_bit;
+
+	troot = s->root.b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	while (1) {
+		if (unlikely(++steps % EBOLC_CHECK_STEPS == 0) && !ebolc_read_validate(s, v))
+			return EBOLC_RETRY;
+
+		if (eb_gettag(troot) == EB_LEAF) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebmb_node, node.branches);
+			return memcmp(node->key, x, len) == 0 ? node : NULL;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebmb_node, node.branches);
+
+		node_bit = node->node.bit;
+		if (node_bit < 0) {
+			/* a duplicate tree: all leaves share the node's key,
+			 * return the first one.
+			 */
+			if (memcmp(node->key, x, len) != 0)
+				return NULL;
+			while (1) {
+				troot = node->node.branches.b[EB_LEFT];
+				if (unlikely(troot == NULL))
+					return EBOLC_RETRY;
+				if (eb_gettag(troot) == EB_LEAF)
+					break;
+				node = container_of(eb_untag(troot, EB_NODE),
+						    struct ebmb_node, node.branches);
+				if (unlikely(++steps % EBOLC_CHECK_STEPS == 0) && !ebolc_read_validate(s, v))
+					return EBOLC_RETRY;
+			}
+			return container_of(eb_untag(troot, EB_LEAF),
+					    struct ebmb_node, node.branches);
+		}
+
+		if (unlikely((unsigned int)node_bit >= len << 3))
+			return EBOLC_RETRY;
+
+		troot = node->node.branches.b[get_bit(x, node_bit)];
+		if (unlikely(troot == NULL))
+			return EBOLC_RETRY;
+	}
+}
+
+/* Looks up key <x> of <len> bytes in tree <root>. Returns the first matching
+ * node or NULL if none matches. Never blocks unless a writer holds the stripe,
+ * and never writes to shared memory.
+ */
+struct ebmb_node *ebolc_lookup(struct ebolc_root *root, const void *x, unsigned int len)
+{
+	struct ebolc_stripe *s = ebolc_stripe(root, x);
+	struct ebmb_node *node;
+	unsigned long v;
+
+	do {
+		v = ebolc_read_begin(s);
+		node = ebolc_walk(s, v, x, len);
+	} while (node == EBOLC_RETRY || !ebolc_read_validate(s, v));
+	return node;
+}
+
+/* Inserts ebmb_node <new> into tree <root>, with the same semantics as
+ * ebmb_insert(). Only the stripe holding the key is locked.
+ */
+struct ebmb_node *ebolc_insert(struct ebolc_root *root, struct ebmb_node *new, unsigned int len)
+{
+	struct ebolc_stripe *s = ebolc_stripe(root, new->key);
+	struct ebmb_node *ret;
+
+	ebolc_write_lock(s);
+	ret = __ebmb_insert(&s->root, new, len);
+	ebolc_write_unlock(s);
+	return ret;
+}
+
+/* Removes node <node> from tree <root> if it is there. Only the stripe holding
+ * the key is locked. The node must not be released before all readers which
+ * may have reached it are gone.
+ */
+void ebolc_delete(struct ebolc_root *root, struct ebmb_node *node)
+{
+	struct ebolc_stripe *s = ebolc_stripe(root, node->key);
+
+	ebolc_write_lock(s);
+	__ebmb_delete(node);
+	ebolc_write_unlock(s);
+}
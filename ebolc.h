@@ -0,0 +1,132 @@
+/*
+ * Elastic Binary Trees - optimistically locked Multi-Byte trees.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* An ebolc tree is an ebmb tree which supports concurrent writers and
+ * lock-free readers. Locking individual nodes does not work well with ebtrees
+ * because a deletion may move a node part anywhere above the deleted leaf, so
+ * the set of nodes touched by a writer is not known before it completes. We
+ * thus lock at the granularity of the topmost subtrees instead : the first
+ * <bits> bits of the key (at most 16) select one of 2^bits independent ebmb
+ * trees called stripes, each of which carries a version word :
+ *   - even : unlocked, odd : locked by a writer ;
+ *   - writers increment it when taking the lock and when releasing it ;
+ *   - readers never write it. They note it before walking down the stripe and
+ *     check that it did not change once done, otherwise they start over.
+ *
+ * Writers on different stripes never contend, and readers never write to
+ * shared memory. Since readers may walk over nodes which are being deleted,
+ * a deleted node's memory must remain mapped until all readers which might
+ * have seen it are gone. Reusing it for another node is fine (eg: eb_pool).
+ * All keys must be at least 2 bytes long when more than 8 bits are used. The
+ * tree only supports non-prefix keys (ebmb_insert semantics).
+ */
+
+#ifndef _EBOLC_H
+#define _EBOLC_H
+
+#include "ebmbtree.h"
+
+/* Default number of bits used to select a stripe */
+#define EBOLC_BITS	8
+
+/* One independently locked subtree */
+struct ebolc_stripe {
+	unsigned long version;
+	struct eb_root root;
+} ALIGNED(64);
+
+/* The root of an ebolc tree */
+struct ebolc_root {
+	unsigned int bits;               /* number of key bits used to select a stripe */
+	struct ebolc_stripe *stripes;    /* 1 << bits stripes */
+};
+
+/* The following functions are not inlined. They are declared in ebolc.c. */
+int ebolc_init(struct ebolc_root *root, unsigned int bits, int unique);
+void ebolc_destroy(struct ebolc_root *root);
+struct ebmb_node *ebolc_lookup(struct ebolc_root *root, const void *x, unsigned int len);
+struct ebmb_node *ebolc_insert(struct ebolc_root *root, struct ebmb_node *new, unsigned int len);
+void ebolc_delete(struct ebolc_root *root, struct ebmb_node *node);
+
+/* Returns the stripe of tree <root> which stores key <x> */
+static inline struct ebolc_stripe *ebolc_stripe(const struct ebolc_root *root, const void *x)
+{
+	const unsigned char *k = x;
+	unsigned int idx;
+
+	if (!root->bits)
+		return root->stripes;
+	if (root->bits <= 8)
+		idx = k[0] >> (8 - root->bits);
+	else
+		idx = ((k[0] << 8) | k[1]) >> (16 - root->bits);
+	return &root->stripes[idx];
+}
+
+/* Locks stripe <s> for writing, waiting for other writers to leave */
+static inline void ebolc_write_lock(struct ebolc_stripe *s)
+{
+	unsigned long v;
+
+	while (1) {
+		v = __atomic_load_n(&s->version, __ATOMIC_RELAXED);
+		if (!(v & 1) &&
+		    __atomic_compare_exchange_n(&s->version, &v, v + 1, 1,
+						__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			break;
+		cpu_relax();
+	}
+	/* the odd version must be visible before any change to the tree,
+	 * otherwise a reader could see the old version and a half-modified
+	 * stripe, and still validate its walk.
+	 */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/* Unlocks stripe <s>, which also makes pending readers start over */
+static inline void ebolc_write_unlock(struct ebolc_stripe *s)
+{
+	__atomic_store_n(&s->version, s->version + 1, __ATOMIC_RELEASE);
+}
+
+/* Waits for stripe <s> to be unlocked and returns its version */
+static inline unsigned long ebolc_read_begin(const struct ebolc_stripe *s)
+{
+	unsigned long v;
+
+	while ((v = __atomic_load_n(&s->version, __ATOMIC_ACQUIRE)) & 1)
+		cpu_relax();
+	return v;
+}
+
+/* Returns non-zero if stripe <s> was not modified since version <v> was read */
+static inline int ebolc_read_validate(const struct ebolc_stripe *s, unsigned long v)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&s->version, __ATOMIC_RELAXED) == v;
+}
+
+#endif /* _EBOLC_H */
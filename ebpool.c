@@ -0,0 +1,273 @@
+/*
+ * Elastic Binary Trees - thread-safe node pools.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebpool.h for more details about those functions */
+
+#include <stdlib.h>
+#include "ebpool.h"
+
+/* Objects start this far from the beginning of a chunk, whose first word
+ * links all chunks of a pool.
+ */
+#define EB_POOL_CHUNK_HDR	64
+
+__thread struct eb_pool_cache eb_pool_caches[EB_POOL_MAX];
+
+/* registered pools, used to flush exiting threads' caches */
+static struct eb_pool *eb_pools[EB_POOL_MAX];
+static pthread_mutex_t eb_pools_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t eb_pool_once = PTHREAD_ONCE_INIT;
+static pthread_key_t eb_pool_key;
+
+/* Gives the magazines of the calling thread for pool <pool> back to its depot.
+ * The pool must be locked.
+ */
+static void eb_pool_release_cache(struct eb_pool *pool)
+{
+	struct eb_pool_cache *cache = &eb_pool_caches[pool->id];
+	struct eb_mag *mag;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		mag = i ? cache->prev : cache->loaded;
+		if (!mag)
+			continue;
+		if (mag->count) {
+			mag->next = pool->full;
+			pool->full = mag;
+		} else {
+			mag->next = pool->empty;
+			pool->empty = mag;
+		}
+	}
+	cache->loaded = cache->prev = NULL;
+}
+
+/* Called when a thread which used any pool exits */
+static void eb_pool_thread_exit(void *arg)
+{
+	struct eb_pool *pool;
+	int i;
+
+	(void)arg;
+	pthread_mutex_lock(&eb_pools_lock);
+	for (i = 0; i < EB_POOL_MAX; i++) {
+		pool = eb_pools[i];
+		if (!pool)
+			continue;
+		pthread_mutex_lock(&pool->lock);
+		eb_pool_release_cache(pool);
+		pthread_mutex_unlock(&pool->lock);
+	}
+	pthread_mutex_unlock(&eb_pools_lock);
+}
+
+static void eb_pool_create_key(void)
+{
+	pthread_key_create(&eb_pool_key, eb_pool_thread_exit);
+}
+
+/* Returns a magazine from the depot of locked pool <pool> if <full> is set
+ * and it has one, otherwise carves a new chunk into an empty magazine. With
+ * <full> unset, an empty magazine is returned. Returns NULL if memory is
+ * exhausted.
+ */
+static struct eb_mag *eb_pool_get_mag(struct eb_pool *pool, int full)
+{
+	struct eb_mag *mag;
+	char *chunk;
+	int i;
+
+	if (full && pool->full) {
+		mag = pool->full;
+		pool->full = mag->next;
+		return mag;
+	}
+
+	if (pool->empty) {
+		mag = pool->empty;
+		pool->empty = mag->next;
+	}
+	else if ((mag = malloc(sizeof(*mag))) == NULL)
+		return NULL;
+	mag->count = 0;
+
+	if (!full)
+		return mag;
+
+	if (posix_memalign((void **)&chunk, EB_POOL_CHUNK_HDR,
+			   EB_POOL_CHUNK_HDR + (size_t)EB_MAG_SIZE * pool->size) != 0) {
+		mag->next = pool->empty;
+		pool->empty = mag;
+		return NULL;
+	}
+
+	*(void **)chunk = pool->chunks;
+	pool->chunks = chunk;
+	for (i = EB_MAG_SIZE - 1; i >= 0; i--)
+		mag->objs[mag->count++] = chunk + EB_POOL_CHUNK_HDR + (size_t)i * pool->size;
+	pool->allocated += EB_MAG_SIZE;
+	return mag;
+}
+
+/* Initializes pool <pool> for objects of <size> bytes. Returns non-zero on
+ * success, or zero if too many pools already exist.
+ */
+int eb_pool_init(struct eb_pool *pool, unsigned int size)
+{
+	int i;
+
+	pthread_once(&eb_pool_once, eb_pool_create_key);
+
+	pool->size = (size + sizeof(void *) - 1) & -(unsigned int)sizeof(void *);
+	pool->full = pool->empty = NULL;
+	pool->chunks = NULL;
+	pool->allocated = 0;
+	pthread_mutex_init(&pool->lock, NULL);
+
+	pthread_mutex_lock(&eb_pools_lock);
+	for (i = 0; i < EB_POOL_MAX && eb_pools[i]; i++)
+		;
+	if (i < EB_POOL_MAX) {
+		eb_pools[i] = pool;
+		pool->id = i;
+	}
+	pthread_mutex_unlock(&eb_pools_lock);
+
+	if (i == EB_POOL_MAX) {
+		pthread_mutex_destroy(&pool->lock);
+		return 0;
+	}
+	return 1;
+}
+
+/* Releases all the memory used by pool <pool>, including all objects. Only
+ * the calling thread's magazines are flushed, other threads must have flushed
+ * theirs or exited.
+ */
+void eb_pool_destroy(struct eb_pool *pool)
+{
+	struct eb_mag *mag;
+	void *chunk;
+
+	pthread_mutex_lock(&eb_pools_lock);
+	eb_pools[pool->id] = NULL;
+	pthread_mutex_unlock(&eb_pools_lock);
+
+	eb_pool_release_cache(pool);
+
+	while ((mag = pool->full) != NULL) {
+		pool->full = mag->next;
+		free(mag);
+	}
+	while ((mag = pool->empty) != NULL) {
+		pool->empty = mag->next;
+		free(mag);
+	}
+	while ((chunk = pool->chunks) != NULL) {
+		pool->chunks = *(void **)chunk;
+		free(chunk);
+	}
+	pthread_mutex_destroy(&pool->lock);
+}
+
+/* Gives the calling thread's magazines for pool <pool> back to the depot */
+void eb_pool_flush(struct eb_pool *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	eb_pool_release_cache(pool);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/* Called by eb_pool_alloc() when the loaded magazine is empty */
+void *eb_pool_alloc_slow(struct eb_pool *pool)
+{
+	struct eb_pool_cache *cache = &eb_pool_caches[pool->id];
+	struct eb_mag *mag;
+
+	if (!cache->loaded && !cache->prev)
+		pthread_setspecific(eb_pool_key, pool);
+
+	if (cache->prev && cache->prev->count) {
+		mag = cache->prev;
+		cache->prev = cache->loaded;
+		cache->loaded = mag;
+		return mag->objs[--mag->count];
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	mag = eb_pool_get_mag(pool, 1);
+	if (!mag) {
+		pthread_mutex_unlock(&pool->lock);
+		return NULL;
+	}
+	/* the previous magazine is empty, the loaded one (if any) too */
+	if (cache->prev) {
+		cache->prev->next = pool->empty;
+		pool->empty = cache->prev;
+	}
+	cache->prev = cache->loaded;
+	cache->loaded = mag;
+	pthread_mutex_unlock(&pool->lock);
+	return mag->objs[--mag->count];
+}
+
+/* Called by eb_pool_free() when the loaded magazine is full */
+void eb_pool_free_slow(struct eb_pool *pool, void *obj)
+{
+	struct eb_pool_cache *cache = &eb_pool_caches[pool->id];
+	struct eb_mag *mag;
+
+	if (!cache->loaded && !cache->prev)
+		pthread_setspecific(eb_pool_key, pool);
+
+	if (cache->prev && !cache->prev->count) {
+		mag = cache->prev;
+		cache->prev = cache->loaded;
+		cache->loaded = mag;
+		mag->objs[mag->count++] = obj;
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	mag = eb_pool_get_mag(pool, 0);
+	if (!mag) {
+		/* no memory for a new magazine. The object will remain unused
+		 * until the pool is destroyed.
+		 */
+		pthread_mutex_unlock(&pool->lock);
+		return;
+	}
+	/* the previous magazine is not empty, the loaded one (if any) is full */
+	if (cache->prev) {
+		cache->prev->next = pool->full;
+		pool->full = cache->prev;
+	}
+	cache->prev = cache->loaded;
+	cache->loaded = mag;
+	pthread_mutex_unlock(&pool->lock);
+	mag->objs[mag->count++] = obj;
+}
@@ -0,0 +1,137 @@
+/*
+ * Elastic Binary Trees - thread-safe node pools.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* A pool hands out fixed-size objects, typically tree nodes. Objects are
+ * carved from large chunks and are never given back to malloc() until the
+ * pool is destroyed, so freeing them from another thread than the one which
+ * allocated them does not make the allocator's arenas grow.
+ *
+ * Each thread keeps two magazines per pool, which are small stacks of free
+ * objects. Allocating pops an object from the loaded magazine and freeing
+ * pushes it there, which is all that happens most of the time. When the
+ * loaded magazine is empty (resp. full), it is swapped with the other one if
+ * this one is full (resp. empty), otherwise it is exchanged with a full (resp.
+ * empty) one from the pool's depot, which is the only place where a lock is
+ * taken. A thread's magazines go back to the depot when it exits.
+ *
+ * A pool may be destroyed once no thread holds any of its objects in its
+ * magazines, which is the case once they have exited or called eb_pool_flush().
+ */
+
+#ifndef _EBPOOL_H
+#define _EBPOOL_H
+
+#include <pthread.h>
+#include "eb32tree.h"
+#include "eb64tree.h"
+#include "ebmbtree.h"
+
+/* Max number of pools which may exist at the same time */
+#define EB_POOL_MAX	64
+
+/* Number of objects per magazine, which is also the number of objects carved
+ * at once from a new chunk.
+ */
+#define EB_MAG_SIZE	64
+
+/* A magazine, a stack of free objects */
+struct eb_mag {
+	struct eb_mag *next;              /* next magazine in the depot */
+	unsigned int count;               /* number of objects in objs[] */
+	void *objs[EB_MAG_SIZE];
+};
+
+/* The magazines a thread holds for one pool */
+struct eb_pool_cache {
+	struct eb_mag *loaded;            /* magazine used for allocs and frees */
+	struct eb_mag *prev;              /* either full or empty, may be NULL */
+};
+
+/* A pool. Everything but <size> and <id> is protected by <lock>. */
+struct eb_pool {
+	unsigned int size;                /* object size, rounded up */
+	unsigned int id;                  /* index of this pool's thread caches */
+	pthread_mutex_t lock;
+	struct eb_mag *full;              /* full magazines in the depot */
+	struct eb_mag *empty;             /* empty magazines in the depot */
+	void *chunks;                     /* list of allocated chunks */
+	unsigned long allocated;          /* number of objects carved so far */
+};
+
+/* per-thread caches, indexed by pool id */
+extern __thread struct eb_pool_cache eb_pool_caches[EB_POOL_MAX];
+
+/* The following functions are not inlined. They are declared in ebpool.c. */
+int eb_pool_init(struct eb_pool *pool, unsigned int size);
+void eb_pool_destroy(struct eb_pool *pool);
+void eb_pool_flush(struct eb_pool *pool);
+void *eb_pool_alloc_slow(struct eb_pool *pool);
+void eb_pool_free_slow(struct eb_pool *pool, void *obj);
+
+/* Returns an object from pool <pool>, or NULL if memory is exhausted. The
+ * object's contents are undefined.
+ */
+static inline void *eb_pool_alloc(struct eb_pool *pool)
+{
+	struct eb_mag *mag = eb_pool_caches[pool->id].loaded;
+
+	if (likely(mag && mag->count))
+		return mag->objs[--mag->count];
+	return eb_pool_alloc_slow(pool);
+}
+
+/* Gives object <obj> back to pool <pool>. It may have been allocated by any
+ * thread.
+ */
+static inline void eb_pool_free(struct eb_pool *pool, void *obj)
+{
+	struct eb_mag *mag = eb_pool_caches[pool->id].loaded;
+
+	if (likely(mag && mag->count < EB_MAG_SIZE))
+		mag->objs[mag->count++] = obj;
+	else
+		eb_pool_free_slow(pool, obj);
+}
+
+/* Initializes pool <pool> for eb32_node objects */
+static inline int eb32_pool_init(struct eb_pool *pool)
+{
+	return eb_pool_init(pool, sizeof(struct eb32_node));
+}
+
+/* Initializes pool <pool> for eb64_node objects */
+static inline int eb64_pool_init(struct eb_pool *pool)
+{
+	return eb_pool_init(pool, sizeof(struct eb64_node));
+}
+
+/* Initializes pool <pool> for ebmb_node objects followed by a <len> bytes key */
+static inline int ebmb_pool_init(struct eb_pool *pool, unsigned int len)
+{
+	return eb_pool_init(pool, sizeof(struct ebmb_node) + len);
+}
+
+#endif /* _EBPOOL_H */
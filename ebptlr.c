@@ -0,0 +1,84 @@
+/*
+ * Elastic Binary Trees - left-right pointer trees with wait-free readers.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebptlr.h for more details about those functions */
+
+#include <sched.h>
+#include "ebptlr.h"
+
+/* Makes readers switch to the instance the writer just updated, and waits for
+ * all readers which may still be using the other one to leave.
+ */
+static void ebptlr_switch(struct ebptlr_root *root)
+{
+	unsigned int prev = root->vi;
+
+	__atomic_store_n(&root->lr, !root->lr, __ATOMIC_SEQ_CST);
+
+	/* readers arriving from now on see the new instance. Those on the
+	 * unused indicator are late ones from a previous switch.
+	 */
+	while (__atomic_load_n(&root->ri[!prev], __ATOMIC_ACQUIRE))
+		sched_yield();
+	__atomic_store_n(&root->vi, !prev, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&root->ri[prev], __ATOMIC_ACQUIRE))
+		sched_yield();
+}
+
+/* Inserts object node <new> with key <key> into tree <root>. Returns <new>,
+ * or the existing node with the same key if the tree has unique keys, in
+ * which case nothing is changed.
+ */
+struct ebptlr_node *ebptlr_insert(struct ebptlr_root *root, struct ebptlr_node *new, void *key)
+{
+	struct ebpt_node *ret;
+	unsigned int lr = root->lr;
+
+	new->n[0].key = new->n[1].key = key;
+	ret = ebpt_insert(&root->root[!lr], &new->n[!lr]);
+	if (ret != &new->n[!lr])
+		return container_of(ret, struct ebptlr_node, n[!lr]);
+
+	ebptlr_switch(root);
+	ebpt_insert(&root->root[lr], &new->n[lr]);
+	return new;
+}
+
+/* Removes object node <node> from tree <root> if it is there. Once this
+ * returns, no reader may find it anymore, so it may be released as soon as
+ * the readers which already found it are done with it.
+ */
+void ebptlr_delete(struct ebptlr_root *root, struct ebptlr_node *node)
+{
+	unsigned int lr = root->lr;
+
+	if (!node->n[!lr].node.leaf_p)
+		return;
+
+	ebpt_delete(&node->n[!lr]);
+	ebptlr_switch(root);
+	ebpt_delete(&node->n[lr]);
+}
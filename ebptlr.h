@@ -0,0 +1,144 @@
+/*
+ * Elastic Binary Trees - left-right pointer trees with wait-free readers.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* An ebptlr tree indexes objects by address like an ebpt tree, but lookups
+ * are wait-free and async-signal-safe even while a writer modifies the tree,
+ * so that they may be performed from signal handlers or profilers. It relies
+ * on the left-right technique : the tree exists in two instances, each object
+ * embedding one ebpt_node per instance. Readers always use the instance
+ * designated by <lr>, which the writer never touches. The writer updates the
+ * other instance, switches <lr>, waits for the readers still using the old
+ * instance to leave, and applies the same change to it.
+ *
+ * Readers announce themselves on one of two read indicators, designated by
+ * <vi>, so that the writer may wait for those which arrived before the switch
+ * without being starved by those which arrive after it. A reader never waits,
+ * it only performs two atomic additions, so it may even interrupt the writer
+ * on the same thread. Writers must be serialized by the caller and must not
+ * run from a signal handler.
+ */
+
+#ifndef _EBPTLR_H
+#define _EBPTLR_H
+
+#include "ebpttree.h"
+
+/* An object's node, one per tree instance. Both carry the same key. */
+struct ebptlr_node {
+	struct ebpt_node n[2];
+};
+
+/* The root of an ebptlr tree */
+struct ebptlr_root {
+	struct eb_root root[2];             /* the two instances */
+	unsigned int lr;                    /* instance used by readers */
+	unsigned int vi;                    /* read indicator new readers use */
+	unsigned long ri[2] ALIGNED(64);    /* read indicators */
+} ALIGNED(64);
+
+#define EBPTLR_ROOT		{ .root = { EB_ROOT, EB_ROOT } }
+#define EBPTLR_ROOT_UNIQUE	{ .root = { EB_ROOT_UNIQUE, EB_ROOT_UNIQUE } }
+
+/* The following functions are not inlined. They are declared in ebptlr.c. */
+struct ebptlr_node *ebptlr_insert(struct ebptlr_root *root, struct ebptlr_node *new, void *key);
+void ebptlr_delete(struct ebptlr_root *root, struct ebptlr_node *node);
+
+/* Returns the key of node <node> */
+static inline void *ebptlr_key(const struct ebptlr_node *node)
+{
+	return node->n[0].key;
+}
+
+/* Enters a read-side section on tree <root> and returns the read indicator
+ * which must be passed to ebptlr_read_end().
+ */
+static inline unsigned int ebptlr_read_begin(struct ebptlr_root *root)
+{
+	unsigned int vi = __atomic_load_n(&root->vi, __ATOMIC_SEQ_CST);
+
+	__atomic_fetch_add(&root->ri[vi], 1, __ATOMIC_SEQ_CST);
+	return vi;
+}
+
+/* Leaves the read-side section entered on read indicator <vi> */
+static inline void ebptlr_read_end(struct ebptlr_root *root, unsigned int vi)
+{
+	__atomic_fetch_sub(&root->ri[vi], 1, __ATOMIC_RELEASE);
+}
+
+/* Returns the instance readers must use on tree <root> */
+static inline unsigned int ebptlr_read_instance(struct ebptlr_root *root)
+{
+	return __atomic_load_n(&root->lr, __ATOMIC_SEQ_CST);
+}
+
+/* Looks up key <x> in tree <root>. Returns the object's node or NULL. The
+ * object must not be released before the caller is done with it, which is
+ * up to the caller to organize with the writer.
+ */
+static inline struct ebptlr_node *ebptlr_lookup(struct ebptlr_root *root, void *x)
+{
+	struct ebpt_node *node;
+	unsigned int vi, lr;
+
+	vi = ebptlr_read_begin(root);
+	lr = ebptlr_read_instance(root);
+	node = ebpt_lookup(&root->root[lr], x);
+	ebptlr_read_end(root, vi);
+	return node ? container_of(node, struct ebptlr_node, n[lr]) : NULL;
+}
+
+/* Looks up the last object whose key is lower than or equal to <x> in tree
+ * <root>, typically the object containing address <x>. Returns NULL if none.
+ */
+static inline struct ebptlr_node *ebptlr_lookup_le(struct ebptlr_root *root, void *x)
+{
+	struct ebpt_node *node;
+	unsigned int vi, lr;
+
+	vi = ebptlr_read_begin(root);
+	lr = ebptlr_read_instance(root);
+	node = ebpt_lookup_le(&root->root[lr], x);
+	ebptlr_read_end(root, vi);
+	return node ? container_of(node, struct ebptlr_node, n[lr]) : NULL;
+}
+
+/* Looks up the first object whose key is greater than or equal to <x> in tree
+ * <root>. Returns NULL if none.
+ */
+static inline struct ebptlr_node *ebptlr_lookup_ge(struct ebptlr_root *root, void *x)
+{
+	struct ebpt_node *node;
+	unsigned int vi, lr;
+
+	vi = ebptlr_read_begin(root);
+	lr = ebptlr_read_instance(root);
+	node = ebpt_lookup_ge(&root->root[lr], x);
+	ebptlr_read_end(root, vi);
+	return node ? container_of(node, struct ebptlr_node, n[lr]) : NULL;
+}
+
+#endif /* _EBPTLR_H */
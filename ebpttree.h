@@ -113,6 +113,12 @@ static forceinline struct ebpt_node *ebpt_prev_unique(struct ebpt_node *ebpt)
 	return ebpt_entry(eb_prev_unique(&ebpt->node), struct ebpt_node, node);
 }
 
+/* Return the next node of cursor <cur>, or NULL if none */
+static inline struct ebpt_node *ebpt_cursor_next(struct eb_cursor *cur)
+{
+	return ebpt_entry(eb_cursor_next(cur), struct ebpt_node, node);
+}
+
 /* Delete node from the tree if it was linked in. Mark the node unused. Note
  * that this function relies on a non-inlined generic function: eb_delete.
  */
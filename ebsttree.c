@@ -37,6 +37,15 @@ struct ebmb_node *ebst_lookup(struct eb_root *root, const char *x)
 	return __ebst_lookup(root, x);
 }
 
+/* Performs ebst_lookup() on the <nb> zero-terminated strings of <keys> in tree
+ * <root>, interleaving the lookups, and stores the results in <res>.
+ */
+void ebst_lookup_batch(struct eb_root *root, const char **keys, unsigned int nb,
+                       struct ebmb_node **res)
+{
+	__ebst_lookup_batch(root, keys, nb, res);
+}
+
 /* Insert ebmb_node <new> into subtree starting at node root <root>. Only
  * new->key needs be set with the zero-terminated string key. The ebmb_node is
  * returned. If root->b[EB_RGHT]==1, the tree may only contain unique keys. The
@@ -46,3 +55,36 @@ struct ebmb_node *ebst_insert(struct eb_root *root, struct ebmb_node *new)
 {
 	return __ebst_insert(root, new);
 }
+
+/* Find the first occurence of the longest string of tree <root> which is a
+ * prefix of the zero-terminated string <x>, including <x> itself. It's the
+ * caller's reponsibility to use this function only on trees which only
+ * contain zero-terminated strings. If none can be found, return NULL.
+ */
+struct ebmb_node *ebst_lookup_longest(struct eb_root *root, const char *x)
+{
+	return __ebst_lookup_longest(root, x);
+}
+
+/* Sets cursor <cur> to walk at most <limit> strings of tree <root> (all of
+ * them if <limit> is zero) starting with the first <len> chars of <x>. It's
+ * the caller's reponsibility to use this function only on trees which only
+ * contain zero-terminated strings. Returns non-zero if at least one string
+ * matches.
+ */
+int ebst_prefix_cursor(struct eb_root *root, const char *x, unsigned int len,
+                       unsigned long limit, struct eb_cursor *cur)
+{
+	return __ebst_prefix_cursor(root, x, len, limit, cur);
+}
+
+/* Deletes all the strings of tree <root> starting with the first <len> chars
+ * of <x>, and passes their nodes to <fn> with <arg> if <fn> is not NULL. It's
+ * the caller's reponsibility to use this function only on trees which only
+ * contain zero-terminated strings. Returns the number of deleted strings.
+ */
+unsigned long ebst_delete_prefix(struct eb_root *root, const char *x, unsigned int len,
+                                 void (*fn)(struct eb_node *node, void *arg), void *arg)
+{
+	return __ebst_delete_prefix(root, x, len, fn, arg);
+}
@@ -37,6 +37,13 @@
  */
 struct ebmb_node *ebst_lookup(struct eb_root *root, const char *x);
 struct ebmb_node *ebst_insert(struct eb_root *root, struct ebmb_node *new);
+struct ebmb_node *ebst_lookup_longest(struct eb_root *root, const char *x);
+void ebst_lookup_batch(struct eb_root *root, const char **keys, unsigned int nb,
+                       struct ebmb_node **res);
+int ebst_prefix_cursor(struct eb_root *root, const char *x, unsigned int len,
+                       unsigned long limit, struct eb_cursor *cur);
+unsigned long ebst_delete_prefix(struct eb_root *root, const char *x, unsigned int len,
+                                 void (*fn)(struct eb_node *node, void *arg), void *arg);
 
 /* Find the first occurence of a length <len> string <x> in the tree <root>.
  * It's the caller's reponsibility to use this function only on trees which
@@ -74,7 +81,8 @@ static forceinline struct ebmb_node *__ebst_lookup(struct eb_root *root, const v
 		if ((eb_gettag(troot) == EB_LEAF)) {
 			node = container_of(eb_untag(troot, EB_LEAF),
 					    struct ebmb_node, node.branches);
-			if (strcmp((char *)node->key, x) == 0)
+			/* the first <bit> bits are already known to match */
+			if (string_equal_bits(x, node->key, bit < 0 ? 0 : bit) < 0)
 				return node;
 			else
 				return NULL;
@@ -88,7 +96,7 @@ static forceinline struct ebmb_node *__ebst_lookup(struct eb_root *root, const v
 			 * value, and we walk down left, or it's a different
 			 * one and we don't have our key.
 			 */
-			if (strcmp((char *)node->key, x) != 0)
+			if (string_equal_bits(x, node->key, bit < 0 ? 0 : bit) >= 0)
 				return NULL;
 
 			troot = node->node.branches.b[EB_LEFT];
@@ -131,6 +139,311 @@ static forceinline struct ebmb_node *__ebst_lookup(struct eb_root *root, const v
 	}
 }
 
+/* Returns the branch pointer of tree <root> holding all the strings starting
+ * with the first <len> chars of <x> and only them, or NULL if there are none,
+ * the same way as __ebmb_prefix_subtree(). It's the caller's reponsibility to
+ * use this function only on trees which only contain zero-terminated strings,
+ * and that no null character is present in string <x> in the first <len>
+ * chars.
+ */
+static forceinline eb_troot_t *__ebst_prefix_subtree(struct eb_root *root, const char *x, unsigned int len)
+{
+	struct ebmb_node *node;
+	eb_troot_t *troot;
+	int node_bit;
+
+	troot = root->b[EB_LEFT];
+	while (eb_gettag(troot) == EB_NODE) {
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebmb_node, node.branches);
+		node_bit = node->node.bit;
+		if (node_bit < 0 || node_bit >= (int)(len << 3))
+			break;
+		troot = node->node.branches.b[(((unsigned char*)x)[node_bit >> 3] >>
+					       (~node_bit & 7)) & 1];
+	}
+
+	if (troot) {
+		/* any leaf of the subtree tells whether it matches */
+		node = container_of(eb_walk_down(troot, EB_LEFT), struct ebmb_node, node);
+		if (strncmp((const char *)node->key, x, len) != 0)
+			troot = NULL;
+	}
+	return troot;
+}
+
+/* Sets cursor <cur> to walk at most <limit> strings of tree <root> (all of
+ * them if <limit> is zero) starting with the first <len> chars of <x>, in
+ * ascending order, such as for completions. Returns non-zero if at least one
+ * string matches, otherwise zero with an empty cursor.
+ */
+static forceinline int __ebst_prefix_cursor(struct eb_root *root, const char *x, unsigned int len,
+                                            unsigned long limit, struct eb_cursor *cur)
+{
+	eb_troot_t *troot = __ebst_prefix_subtree(root, x, len);
+
+	eb_cursor_init(cur, troot, limit);
+	return troot != NULL;
+}
+
+/* Deletes all the strings of tree <root> starting with the first <len> chars
+ * of <x>, such as for purging a whole directory, and passes their nodes in no
+ * particular order to <fn> with <arg> if <fn> is not NULL, for instance to
+ * free them. The subtree holding them is detached from the tree at once by
+ * eb_detach(). Returns the number of deleted strings.
+ */
+static forceinline unsigned long __ebst_delete_prefix(struct eb_root *root, const char *x, unsigned int len,
+                                                      void (*fn)(struct eb_node *node, void *arg), void *arg)
+{
+	return eb_detach(__ebst_prefix_subtree(root, x, len), fn, arg);
+}
+
+/* Returns the first key of the deepest of the <nb> branches of <cand> which
+ * ends at the byte designated by the branch, or <best> if there is none. This
+ * is used by __ebst_lookup_longest() once the descent is over, so that only
+ * the branches which may hold the result are walked down.
+ */
+static forceinline struct ebmb_node *__ebst_longest_cand(const struct eb_longest_cand *cand, int nb,
+                                                        struct ebmb_node *best)
+{
+	struct ebmb_node *node;
+
+	while (nb--) {
+		node = container_of(eb_walk_down(cand[nb].troot, EB_LEFT),
+				    struct ebmb_node, node);
+		if (!node->key[cand[nb].pos])
+			return node;
+	}
+	return best;
+}
+
+/* Find the first occurence of the longest string of tree <root> which is a
+ * prefix of the zero-terminated string <x>, including <x> itself. This is
+ * what is needed to route a path to the longest registered path prefix. The
+ * tree is walked down only once : a stored string <s> being a prefix of <x>
+ * only differs from it at the first byte of <x> past <s>'s length, where <s>
+ * has its trailing zero, so it always lies in the left branch of the node on
+ * <x>'s path which tests the highest bit set in this byte of <x>, and is the
+ * first key of this branch. These branches are recorded along the descent,
+ * there is at most one per byte of <x>. Once the descent is over and no longer
+ * string matched, they are walked down from the deepest one, stopping at the
+ * first one whose first key ends there. It's the caller's
+ * reponsibility to use this function only on trees which only contain
+ * zero-terminated strings. If none can be found, return NULL.
+ */
+static forceinline struct ebmb_node *__ebst_lookup_longest(struct eb_root *root, const void *x)
+{
+	const unsigned char *k = x;
+	struct ebmb_node *node, *best;
+	struct eb_longest_cand cand[EB_LONGEST_CANDS];
+	eb_troot_t *troot;
+	int nbc;
+	int bit;
+	int node_bit;
+	int side;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	best = NULL;
+	nbc = 0;
+	bit = 0;
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebmb_node, node.branches);
+			/* the first <bit> bits are already known to match */
+			bit = string_equal_bits(x, node->key, bit < 0 ? 0 : bit);
+			if (bit < 0 || !node->key[bit >> 3])
+				return node;
+			return __ebst_longest_cand(cand, nbc, best);
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebmb_node, node.branches);
+		node_bit = node->node.bit;
+
+		if (node_bit < 0) {
+			/* We have a dup tree now. Either it's for a prefix of
+			 * <x>, and we walk down left, or it's a different one
+			 * and the best one was already found.
+			 */
+			bit = string_equal_bits(x, node->key, bit < 0 ? 0 : bit);
+			if (bit >= 0 && node->key[bit >> 3])
+				return __ebst_longest_cand(cand, nbc, best);
+
+			troot = node->node.branches.b[EB_LEFT];
+			while (eb_gettag(troot) != EB_LEAF)
+				troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebmb_node, node.branches);
+			return node;
+		}
+
+		/* OK, normal data node, let's walk down but don't compare data
+		 * if we already reached the end of the key.
+		 */
+		if (likely(bit >= 0)) {
+			bit = string_equal_bits(x, node->key, bit);
+			if (likely(bit < node_bit)) {
+				if (bit >= 0) {
+					/* no more common bits. All keys below
+					 * differ from <x> at <bit>, only the
+					 * first one may end there.
+					 */
+					troot = node->node.branches.b[EB_LEFT];
+					while (eb_gettag(troot) != EB_LEAF)
+						troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+					node = container_of(eb_untag(troot, EB_LEAF),
+							    struct ebmb_node, node.branches);
+					if (node->key[bit >> 3])
+						return __ebst_longest_cand(cand, nbc, best);
+					return node;
+				}
+
+				/* bit < 0 : we reached the end of the key. If we
+				 * are in a tree with unique keys, we can return
+				 * this node. Otherwise we have to walk it down
+				 * and stop comparing bits.
+				 */
+				if (eb_gettag(root->b[EB_RGHT]))
+					return node;
+			}
+			/* if the bit is larger than the node's, we must bound it
+			 * because we might have compared too many bytes with an
+			 * inappropriate leaf.
+			 */
+			else
+				bit = node_bit;
+		}
+
+		side = k[node_bit >> 3] >> (~node_bit & 7);
+		if (side == 1 && bit >= 0) {
+			/* <x> has no other bit set in this byte, a shorter
+			 * string may end here in the left branch. It is only
+			 * checked once we know no longer one matches.
+			 */
+			if (unlikely(nbc == EB_LONGEST_CANDS)) {
+				best = __ebst_longest_cand(cand, nbc, best);
+				nbc = 0;
+			}
+			cand[nbc].troot = node->node.branches.b[EB_LEFT];
+			cand[nbc].pos = node_bit >> 3;
+			nbc++;
+		}
+		troot = node->node.branches.b[side & 1];
+	}
+}
+
+/* State of one lookup in __ebst_lookup_batch() */
+struct ebst_lane {
+	const unsigned char *x; /* the string being looked up */
+	eb_troot_t *troot;      /* next branch to visit */
+	int bit;                /* number of bits already known to match, or -1 */
+	unsigned int idx;       /* index of the string in the batch */
+};
+
+/* Performs one step of __ebst_lookup() for lane <l> in tree <root>, and
+ * prefetches the next node it will visit. Returns NULL as long as the lookup
+ * is not complete. Otherwise the result is returned, or EBMB_LANE_NONE if the
+ * string is not in the tree.
+ */
+static forceinline struct ebmb_node *__ebst_lookup_step(struct eb_root *root, struct ebst_lane *l)
+{
+	struct ebmb_node *node;
+	eb_troot_t *troot = l->troot;
+	int node_bit;
+
+	if ((eb_gettag(troot) == EB_LEAF)) {
+		node = container_of(eb_untag(troot, EB_LEAF),
+				    struct ebmb_node, node.branches);
+		if (string_equal_bits(l->x, node->key, l->bit < 0 ? 0 : l->bit) < 0)
+			return node;
+		return EBMB_LANE_NONE;
+	}
+	node = container_of(eb_untag(troot, EB_NODE),
+			    struct ebmb_node, node.branches);
+	node_bit = node->node.bit;
+
+	if (node_bit < 0) {
+		/* dup tree, see __ebst_lookup() */
+		if (string_equal_bits(l->x, node->key, l->bit < 0 ? 0 : l->bit) >= 0)
+			return EBMB_LANE_NONE;
+
+		troot = node->node.branches.b[EB_LEFT];
+		while (eb_gettag(troot) != EB_LEAF)
+			troot = (eb_untag(troot, EB_NODE))->b[EB_LEFT];
+		return container_of(eb_untag(troot, EB_LEAF),
+				    struct ebmb_node, node.branches);
+	}
+
+	if (likely(l->bit >= 0)) {
+		l->bit = string_equal_bits(l->x, node->key, l->bit);
+		if (likely(l->bit < node_bit)) {
+			if (l->bit >= 0)
+				return EBMB_LANE_NONE;
+			if (eb_gettag(root->b[EB_RGHT]))
+				return node;
+		}
+		else
+			l->bit = node_bit;
+	}
+
+	troot = node->node.branches.b[(l->x[node_bit >> 3] >> (~node_bit & 7)) & 1];
+	__builtin_prefetch(troot);
+	l->troot = troot;
+	return NULL;
+}
+
+/* Performs __ebst_lookup() on the <nb> zero-terminated strings of <keys> in
+ * tree <root>, and stores the results in <res>. Lookups are interleaved the
+ * same way as in __ebmb_lookup_longest_batch(), which is mostly useful on
+ * trees which do not fit in the CPU caches.
+ */
+static forceinline void __ebst_lookup_batch(struct eb_root *root, const char **keys,
+					    unsigned int nb, struct ebmb_node **res)
+{
+	struct ebst_lane lanes[EBMB_BATCH_LANES];
+	struct ebmb_node *node;
+	unsigned int next, active, i;
+
+	if (unlikely(root->b[EB_LEFT] == NULL)) {
+		for (i = 0; i < nb; i++)
+			res[i] = NULL;
+		return;
+	}
+
+	__builtin_prefetch(root->b[EB_LEFT]);
+	for (next = active = 0; active < EBMB_BATCH_LANES && next < nb; active++, next++) {
+		lanes[active].x = (const unsigned char *)keys[next];
+		lanes[active].troot = root->b[EB_LEFT];
+		lanes[active].bit = 0;
+		lanes[active].idx = next;
+	}
+
+	while (active) {
+		for (i = 0; i < active; ) {
+			node = __ebst_lookup_step(root, &lanes[i]);
+			if (!node) {
+				i++;
+				continue;
+			}
+			res[lanes[i].idx] = node == EBMB_LANE_NONE ? NULL : node;
+
+			if (next < nb) {
+				/* start the next lookup in this lane */
+				lanes[i].x = (const unsigned char *)keys[next];
+				lanes[i].troot = root->b[EB_LEFT];
+				lanes[i].bit = 0;
+				lanes[i].idx = next++;
+				i++;
+			}
+			else
+				lanes[i] = lanes[--active];
+		}
+	}
+}
+
 /* Insert ebmb_node <new> into subtree starting at node root <root>. Only
  * new->key needs be set with the zero-terminated string key. The ebmb_node is
  * returned. If root->b[EB_RGHT]==1, the tree may only contain unique keys. The
@@ -31,6 +31,11 @@ void eb_delete(struct eb_node *node)
 	__eb_delete(node);
 }
 
+unsigned long eb_detach(eb_troot_t *troot, void (*fn)(struct eb_node *node, void *arg), void *arg)
+{
+	return __eb_detach(troot, fn, arg);
+}
+
 /* used by insertion primitives */
 struct eb_node *eb_insert_dup(struct eb_node *sub, struct eb_node *new)
 {
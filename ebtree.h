@@ -407,6 +407,31 @@ struct eb_node {
 #define EB_TREE_HEAD(name)				\
 	struct eb_root name = EB_ROOT
 
+/* A cursor walks the leaves of a subtree in ascending order, such as all the
+ * keys sharing a prefix. The next leaf is looked up before returning the
+ * current one, so that the caller may delete the leaves it gets.
+ */
+struct eb_cursor {
+	struct eb_node *node;    /* next leaf to return, NULL once done */
+	struct eb_node *last;    /* last leaf of the subtree */
+	unsigned long left;      /* max number of leaves left to return */
+};
+
+/* Number of candidate branches recorded by a longest prefix lookup on strings
+ * before they have to be checked. May be changed at build time.
+ */
+#ifndef EB_LONGEST_CANDS
+#define EB_LONGEST_CANDS	32
+#endif
+
+/* A branch whose first key may be a prefix of the looked up string, if it
+ * ends at byte <pos>.
+ */
+struct eb_longest_cand {
+	eb_troot_t *troot;       /* the branch */
+	int pos;                 /* position of the byte which must be zero */
+};
+
 
 /***************************************\
  * Private functions. Not for end-user *
@@ -585,6 +610,34 @@ static inline struct eb_node *eb_next(struct eb_node *node)
 	return eb_walk_down(t, EB_LEFT);
 }
 
+/* Sets cursor <cur> to walk the leaves below branch pointer <troot>, at most
+ * <limit> of them unless <limit> is zero. <troot> may be NULL, in which case
+ * the cursor returns nothing.
+ */
+static inline void eb_cursor_init(struct eb_cursor *cur, eb_troot_t *troot, unsigned long limit)
+{
+	cur->node = eb_walk_down(troot, EB_LEFT);
+	cur->last = eb_walk_down(troot, EB_RGHT);
+	cur->left = limit ? limit : ~0UL;
+}
+
+/* Returns the next leaf of cursor <cur>, or NULL once the subtree or the limit
+ * is reached. The returned leaf may be deleted, but no other leaf of the
+ * subtree.
+ */
+static inline struct eb_node *eb_cursor_next(struct eb_cursor *cur)
+{
+	struct eb_node *node = cur->node;
+
+	if (!node)
+		return NULL;
+	if (node == cur->last || !--cur->left)
+		cur->node = NULL;
+	else
+		cur->node = eb_next(node);
+	return node;
+}
+
 /* Return previous leaf node within a duplicate sub-tree, or NULL if none. */
 static inline struct eb_node *eb_prev_dup(struct eb_node *node)
 {
@@ -781,6 +834,266 @@ static forceinline void __eb_delete(struct eb_node *node)
 	return; /* tree is not empty yet */
 }
 
+/* Detaches the whole subtree designated by branch pointer <troot> from the
+ * tree it belongs to, whatever its size, and passes each of its leaves to
+ * <fn> with <arg> if <fn> is not NULL, for instance to free them. Only the
+ * subtree's parent node is released, as when deleting a leaf. A node part
+ * belongs to a leaf below it, so all the node parts inside the subtree belong
+ * to its leaves, which thus own all of them but one. This last one is either
+ * the one of the parent or the one of another node above it, which is then
+ * moved to the parent's storage, or no node part at all. The subtree is then
+ * walked once, and a leaf is passed to <fn> as soon as the walk does not need
+ * its node part anymore, so leaves come in no particular order. Returns the
+ * number of leaves, which are all marked unlinked.
+ */
+static forceinline unsigned long __eb_detach(eb_troot_t *troot, void (*fn)(struct eb_node *node, void *arg), void *arg)
+{
+	struct eb_node *top, *parent, *node, *last, *next;
+	struct eb_root *gparent;
+	unsigned int pside, gpside;
+	unsigned long nb = 0;
+	eb_troot_t *t;
+	int unused;
+
+	if (!troot)
+		return 0;
+
+	if (eb_gettag(troot) == EB_LEAF) {
+		top = eb_root_to_node(eb_untag(troot, EB_LEAF));
+		__eb_delete(top);
+		if (fn)
+			fn(top, arg);
+		return 1;
+	}
+
+	top = eb_root_to_node(eb_untag(troot, EB_NODE));
+	pside = eb_gettag(top->node_p);
+	parent = eb_root_to_node(eb_untag(top->node_p, pside));
+
+	if (eb_clrtag(parent->branches.b[EB_RGHT]) == NULL) {
+		/* the subtree is the whole tree */
+		parent->branches.b[EB_LEFT] = NULL;
+		goto walk;
+	}
+
+	/* look for the node above the subtree whose leaf is inside it, from
+	 * the parent to the root. Walking up from its leaf, we meet either the
+	 * top of the subtree or the node itself.
+	 */
+	node = parent;
+	while (1) {
+		t = node->leaf_p;
+		while (1) {
+			next = eb_root_to_node(eb_untag(t, eb_gettag(t)));
+			if (next == top || next == node)
+				break;
+			t = next->node_p;
+		}
+		if (next == top)
+			break;
+		t = node->node_p;
+		node = eb_root_to_node(eb_untag(t, eb_gettag(t)));
+		if (eb_clrtag(node->branches.b[EB_RGHT]) == NULL) {
+			node = NULL; /* we reached the root */
+			break;
+		}
+	}
+
+	/* release the parent and reattach the sibling to the grand parent */
+	gpside = eb_gettag(parent->node_p);
+	gparent = eb_untag(parent->node_p, gpside);
+
+	gparent->b[gpside] = parent->branches.b[!pside];
+	if (eb_gettag(gparent->b[gpside]) == EB_LEAF)
+		eb_root_to_node(eb_untag(gparent->b[gpside], EB_LEAF))->leaf_p =
+			eb_dotag(gparent, gpside);
+	else
+		eb_root_to_node(eb_untag(gparent->b[gpside], EB_NODE))->node_p =
+			eb_dotag(gparent, gpside);
+	parent->node_p = NULL;
+
+	if (!node || node == parent)
+		goto walk;
+
+	/* The parent's node part belongs to a leaf outside of the subtree and
+	 * below <node>, it may replace <node>'s one.
+	 */
+	parent->node_p = node->node_p;
+	parent->branches = node->branches;
+	parent->bit = node->bit;
+	node->node_p = NULL;
+
+	gpside = eb_gettag(parent->node_p);
+	gparent = eb_untag(parent->node_p, gpside);
+	gparent->b[gpside] = eb_dotag(&parent->branches, EB_NODE);
+
+	for (pside = 0; pside <= 1; pside++) {
+		if (eb_gettag(parent->branches.b[pside]) == EB_NODE)
+			eb_root_to_node(eb_untag(parent->branches.b[pside], EB_NODE))->node_p =
+				eb_dotag(&parent->branches, pside);
+		else
+			eb_root_to_node(eb_untag(parent->branches.b[pside], EB_LEAF))->leaf_p =
+				eb_dotag(&parent->branches, pside);
+	}
+
+ walk:
+	/* The subtree is intact and is walked from its first leaf to its last
+	 * one, which never walks up past its top. A node part is not needed
+	 * anymore once the walk went up from its right branch, so its leaf,
+	 * which was already visited, may be released. Leaves without a node
+	 * part are released once the next one is known, and the node parts on
+	 * the right edge of the subtree, which are never walked up, at the end.
+	 */
+	last = eb_walk_down(troot, EB_RGHT);
+	next = eb_walk_down(troot, EB_LEFT);
+	do {
+		node = next;
+		unused = !node->node_p;
+		next = NULL;
+		if (node != last) {
+			t = node->leaf_p;
+			while (eb_gettag(t) != EB_LEFT) {
+				next = eb_root_to_node(eb_untag(t, EB_RGHT));
+				t = next->node_p;
+				next->leaf_p = NULL;
+				nb++;
+				if (fn)
+					fn(next, arg);
+			}
+			next = eb_walk_down((eb_untag(t, EB_LEFT))->b[EB_RGHT], EB_LEFT);
+		}
+		if (unused) {
+			node->leaf_p = NULL;
+			nb++;
+			if (fn)
+				fn(node, arg);
+		}
+	} while (next);
+
+	while (eb_gettag(troot) == EB_NODE) {
+		node = eb_root_to_node(eb_untag(troot, EB_NODE));
+		troot = node->branches.b[EB_RGHT];
+		node->leaf_p = NULL;
+		nb++;
+		if (fn)
+			fn(node, arg);
+	}
+	return nb;
+}
+
+/* Keys are compared one block at a time when possible, a block being a vector
+ * register with SSE2, SSE4.2 or AVX2, or a machine word otherwise. Blocks are
+ * loaded unaligned. Strings may be read past their trailing zero, as long as
+ * the block does not cross a page boundary, so this may be reported by memory
+ * checkers. Build with EB_NO_BLOCK_CMP to compare one byte at a time.
+ *
+ * With EB_CPU_DISPATCH, comparisons are performed by the eb_memdiff() and
+ * eb_strdiff() functions instead, whose kernel is selected at load time
+ * depending on the CPU's capabilities. See ebcmp.c.
+ */
+
+/* These functions are declared in ebcmp.c */
+unsigned int eb_memdiff(const unsigned char *a, const unsigned char *b, unsigned int len);
+unsigned int eb_strdiff(const unsigned char *a, const unsigned char *b);
+const char *eb_cmp_kernel(void);
+
+#if !defined(EB_CPU_DISPATCH) && !defined(EB_NO_BLOCK_CMP)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define EB_BLOCK_SIZE	32
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>
+#define EB_BLOCK_SIZE	16
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define EB_BLOCK_SIZE	16
+#else
+#define EB_BLOCK_SIZE	sizeof(unsigned long)
+#endif
+#endif
+
+#ifdef EB_BLOCK_SIZE
+
+/* Smallest page size we may run on */
+#define EB_PAGE_SIZE	4096
+
+/* Returns non-zero if a block may be read at <p> without crossing a page */
+static forceinline int eb_block_in_page(const unsigned char *p)
+{
+	return ((unsigned long)p & (EB_PAGE_SIZE - 1)) <= EB_PAGE_SIZE - EB_BLOCK_SIZE;
+}
+
+/* Compares the blocks at <a> and <b>, and returns the position of the first
+ * byte which differs, or which is zero in <b> if <str> is set. Returns
+ * EB_BLOCK_SIZE if all bytes are equal (and non-zero).
+ */
+static forceinline unsigned int eb_block_first(const unsigned char *a,
+					       const unsigned char *b,
+					       int str)
+{
+#if defined(__AVX2__)
+	__m256i va = _mm256_loadu_si256((const __m256i *)a);
+	__m256i vb = _mm256_loadu_si256((const __m256i *)b);
+	unsigned int m;
+
+	m = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+	if (str)
+		m |= _mm256_movemask_epi8(_mm256_cmpeq_epi8(vb, _mm256_setzero_si256()));
+	return m ? (unsigned int)__builtin_ctz(m) : EB_BLOCK_SIZE;
+#elif defined(__SSE2__)
+	__m128i va = _mm_loadu_si128((const __m128i *)a);
+	__m128i vb = _mm_loadu_si128((const __m128i *)b);
+	unsigned int m;
+
+#if defined(__SSE4_2__)
+	/* PCMPISTRI reports the first byte which differs, including where
+	 * only one string ends. When both end at the same place, it reports
+	 * nothing but sets ZF, and we locate the zero ourselves.
+	 */
+	if (str) {
+		const int mode = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_EACH |
+		                 _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT;
+		int idx = _mm_cmpistri(va, vb, mode);
+
+		if (idx < 16)
+			return idx;
+		if (!_mm_cmpistrz(va, vb, mode))
+			return EB_BLOCK_SIZE;
+		return __builtin_ctz(_mm_movemask_epi8(_mm_cmpeq_epi8(vb, _mm_setzero_si128())));
+	}
+#endif
+	m = ~_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) & 0xFFFF;
+	if (str)
+		m |= _mm_movemask_epi8(_mm_cmpeq_epi8(vb, _mm_setzero_si128()));
+	return m ? (unsigned int)__builtin_ctz(m) : EB_BLOCK_SIZE;
+#else
+	const unsigned long lo7 = ~0UL / 0xFF * 0x7F;
+	unsigned long wa, wb, x, m;
+
+	__builtin_memcpy(&wa, a, sizeof(wa));
+	__builtin_memcpy(&wb, b, sizeof(wb));
+
+	/* set the high bit of each byte which is non-zero in <x>, or zero in
+	 * <wb>. Unlike the usual has-zero trick, this one is exact for every
+	 * byte, so that we can locate the first one.
+	 */
+	x = wa ^ wb;
+	m = ((x & lo7) + lo7) | x;
+	if (str)
+		m |= ~(((wb & lo7) + lo7) | wb);
+	m &= ~lo7;
+	if (!m)
+		return EB_BLOCK_SIZE;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return __builtin_clzl(m) >> 3;
+#else
+	return __builtin_ctzl(m) >> 3;
+#endif
+#endif
+}
+
+#endif /* EB_BLOCK_SIZE */
+
 /* Compare blocks <a> and <b> byte-to-byte, from bit <ignore> to bit <len-1>.
  * Return the number of equal bits between strings, assuming that the first
  * <ignore> bits are already identical. It is possible to return slightly more
@@ -792,6 +1105,28 @@ static forceinline int equal_bits(const unsigned char *a,
 				  const unsigned char *b,
 				  int ignore, int len)
 {
+#if defined(EB_CPU_DISPATCH)
+	int beg = ignore >> 3, end = (len + 7) >> 3;
+
+	if (beg < end) {
+		beg += eb_memdiff(a + beg, b + beg, end - beg);
+		if (beg < end)
+			return ((beg + 1) << 3) - flsnz8(a[beg] ^ b[beg]);
+	}
+	return beg << 3;
+#else
+#ifdef EB_BLOCK_SIZE
+	/* skip whole identical blocks as long as they fit in <len> */
+	for (ignore >>= 3; (ignore + (int)EB_BLOCK_SIZE) << 3 <= len; ignore += EB_BLOCK_SIZE) {
+		unsigned int pos = eb_block_first(a + ignore, b + ignore, 0);
+
+		if (pos < EB_BLOCK_SIZE) {
+			ignore += pos;
+			return ((ignore + 1) << 3) - flsnz8(a[ignore] ^ b[ignore]);
+		}
+	}
+	ignore <<= 3;
+#endif
 	for (ignore >>= 3, a += ignore, b += ignore, ignore <<= 3;
 	     ignore < len; ) {
 		unsigned char c;
@@ -811,6 +1146,7 @@ static forceinline int equal_bits(const unsigned char *a,
 		}
 	}
 	return ignore;
+#endif
 }
 
 /* check that the two blocks <a> and <b> are equal on <len> bits. If it is known
@@ -824,6 +1160,24 @@ static forceinline int check_bits(const unsigned char *a,
 {
 	int bit, ret;
 
+#if defined(EB_CPU_DISPATCH)
+	/* compare all full bytes at once */
+	if (skip < len >> 3) {
+		if ((int)eb_memdiff(a + skip, b + skip, (len >> 3) - skip) < (len >> 3) - skip)
+			return 1;
+		skip = len >> 3;
+	}
+	if (skip << 3 >= len)
+		return 0;
+#elif defined(EB_BLOCK_SIZE)
+	/* skip whole identical blocks as long as they fit in <len> */
+	for (; (skip + (int)EB_BLOCK_SIZE) << 3 <= len; skip += EB_BLOCK_SIZE)
+		if (eb_block_first(a + skip, b + skip, 0) < EB_BLOCK_SIZE)
+			return 1;
+	if (skip << 3 >= len)
+		return 0;
+#endif
+
 	/* This uncommon construction gives the best performance on x86 because
 	 * it makes heavy use multiple-index addressing and parallel instructions,
 	 * and it prevents gcc from reordering the loop since it is already
@@ -863,12 +1217,35 @@ static forceinline int string_equal_bits(const unsigned char *a,
 
 	beg = ignore >> 3;
 
+#if defined(EB_CPU_DISPATCH)
+	beg += eb_strdiff(a + beg, b + beg);
+	c = a[beg] ^ b[beg];
+	if (!c)
+		return -1;
+	return ((beg + 1) << 3) - flsnz8(c);
+#else
 	/* skip known and identical bits. We stop at the first different byte
 	 * or at the first zero we encounter on either side.
 	 */
 	while (1) {
 		unsigned char d;
 
+#ifdef EB_BLOCK_SIZE
+		/* skip whole blocks when they are safe to read, and fall back
+		 * to single bytes around page boundaries.
+		 */
+		if (eb_block_in_page(a + beg) && eb_block_in_page(b + beg)) {
+			unsigned int pos = eb_block_first(a + beg, b + beg, 1);
+
+			beg += pos;
+			if (pos == EB_BLOCK_SIZE)
+				continue;
+			c = a[beg] ^ b[beg];
+			if (!c)
+				return -1;
+			return ((beg + 1) << 3) - flsnz8(c);
+		}
+#endif
 		c = a[beg];
 		d = b[beg];
 		beg++;
@@ -885,6 +1262,7 @@ static forceinline int string_equal_bits(const unsigned char *a,
 	 * in the byte, as we compare them as strings.
 	 */
 	return (beg << 3) - flsnz8(c);
+#endif
 }
 
 static forceinline int cmp_bits(const unsigned char *a, const unsigned char *b, unsigned int pos)
@@ -912,6 +1290,7 @@ static forceinline int get_bit(const unsigned char *a, unsigned int pos)
 
 /* These functions are declared in ebtree.c */
 void eb_delete(struct eb_node *node);
+unsigned long eb_detach(eb_troot_t *troot, void (*fn)(struct eb_node *node, void *arg), void *arg);
 struct eb_node *eb_insert_dup(struct eb_node *sub, struct eb_node *new);
 
 #endif /* _EB_TREE_H */
@@ -0,0 +1,75 @@
+/*
+ * Elastic Binary Trees - exported functions for variable-length binary keys.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebvbtree.h for more details about those functions */
+
+#include "ebvbtree.h"
+
+/* Find the first occurence of the <len> bytes key <x> in the tree <root>.
+ * If none can be found, return NULL.
+ */
+struct ebvb_node *ebvb_lookup(struct eb_root *root, const void *x, unsigned int len)
+{
+	return __ebvb_lookup(root, x, len);
+}
+
+/* Find the first occurence of the lowest key in the tree <root> which is
+ * equal to or greater than the <len> bytes key <x>. If none can be found,
+ * return NULL.
+ */
+struct ebvb_node *ebvb_lookup_ge(struct eb_root *root, const void *x, unsigned int len)
+{
+	return __ebvb_lookup_ge(root, x, len);
+}
+
+/* Insert ebvb_node <new> into subtree starting at node root <root>. Only
+ * new->key and new->len need be set. The ebvb_node is returned. If
+ * root->b[EB_RGHT]==1, the tree may only contain unique keys.
+ */
+struct ebvb_node *ebvb_insert(struct eb_root *root, struct ebvb_node *new)
+{
+	return __ebvb_insert(root, new);
+}
+
+/* Sets cursor <cur> to walk at most <limit> keys of tree <root> (all of them
+ * if <limit> is zero) starting with the <len> bytes of <x>. Returns non-zero
+ * if at least one key matches.
+ */
+int ebvb_prefix_cursor(struct eb_root *root, const void *x, unsigned int len,
+                       unsigned long limit, struct eb_cursor *cur)
+{
+	return __ebvb_prefix_cursor(root, x, len, limit, cur);
+}
+
+/* Deletes all the keys of tree <root> starting with the <len> bytes of <x>,
+ * passing their nodes to <fn> with <arg> if <fn> is not NULL. Returns the
+ * number of deleted keys.
+ */
+unsigned long ebvb_delete_prefix(struct eb_root *root, const void *x, unsigned int len,
+                                 void (*fn)(struct eb_node *node, void *arg), void *arg)
+{
+	return __ebvb_delete_prefix(root, x, len, fn, arg);
+}
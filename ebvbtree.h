@@ -0,0 +1,530 @@
+/*
+ * Elastic Binary Trees - macros and structures for variable-length binary keys.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Variable-length binary keys. ebst keys may not contain a zero and ebmb keys
+ * must all have the same length, so keys such as encoded identifiers or paths
+ * holding zeroes have no home in either. ebvb nodes store the length of their
+ * key before it, and keys are compared as byte strings, a key sorting before
+ * all the longer ones it starts. The tree works as if each byte of a key was
+ * preceded by a one bit, and the key was followed by a zero bit. This way no
+ * key is a prefix of another one, and the first difference between two keys
+ * of different lengths lies on the bit after the shorter one, which is zero
+ * for it. Nothing is ever encoded, these bits are only derived from the length
+ * when the key is compared. Bit positions are thus counted in 9-bit bytes.
+ */
+
+#ifndef _EBVBTREE_H
+#define _EBVBTREE_H
+
+#include <string.h>
+#include "ebtree.h"
+
+/* Return the structure of type <type> whose member <member> points to <ptr> */
+#define ebvb_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define EBVB_ROOT	EB_ROOT
+#define EBVB_TREE_HEAD	EB_TREE_HEAD
+
+/* Max length of a key, so that all bit positions fit in node.bit */
+#define EBVB_MAX_LEN	3640
+
+/* This structure carries a node, a leaf, and a key of <len> bytes. Just like
+ * for ebmb_node, the key is located exactly at the end of the struct, and
+ * 'node.bit' contains the number of identical bits between the two branches.
+ */
+struct ebvb_node {
+	struct eb_node node; /* the tree node, must be at the beginning */
+	unsigned int len;    /* length of the key in bytes */
+	ALWAYS_ALIGN(sizeof(void*));
+	unsigned char key[0]; /* the key, its size depends on the application */
+} ALIGNED(sizeof(void*));
+
+/*
+ * Exported functions and macros.
+ * Many of them are always inlined because they are extremely small, and
+ * are generally called at most once or twice in a program.
+ */
+
+/* Return leftmost node in the tree, or NULL if none */
+static forceinline struct ebvb_node *ebvb_first(struct eb_root *root)
+{
+	return ebvb_entry(eb_first(root), struct ebvb_node, node);
+}
+
+/* Return rightmost node in the tree, or NULL if none */
+static forceinline struct ebvb_node *ebvb_last(struct eb_root *root)
+{
+	return ebvb_entry(eb_last(root), struct ebvb_node, node);
+}
+
+/* Return next node in the tree, or NULL if none */
+static forceinline struct ebvb_node *ebvb_next(struct ebvb_node *ebvb)
+{
+	return ebvb_entry(eb_next(&ebvb->node), struct ebvb_node, node);
+}
+
+/* Return previous node in the tree, or NULL if none */
+static forceinline struct ebvb_node *ebvb_prev(struct ebvb_node *ebvb)
+{
+	return ebvb_entry(eb_prev(&ebvb->node), struct ebvb_node, node);
+}
+
+/* Return next leaf node within a duplicate sub-tree, or NULL if none. */
+static inline struct ebvb_node *ebvb_next_dup(struct ebvb_node *ebvb)
+{
+	return ebvb_entry(eb_next_dup(&ebvb->node), struct ebvb_node, node);
+}
+
+/* Return previous leaf node within a duplicate sub-tree, or NULL if none. */
+static inline struct ebvb_node *ebvb_prev_dup(struct ebvb_node *ebvb)
+{
+	return ebvb_entry(eb_prev_dup(&ebvb->node), struct ebvb_node, node);
+}
+
+/* Return next node in the tree, skipping duplicates, or NULL if none */
+static forceinline struct ebvb_node *ebvb_next_unique(struct ebvb_node *ebvb)
+{
+	return ebvb_entry(eb_next_unique(&ebvb->node), struct ebvb_node, node);
+}
+
+/* Return previous node in the tree, skipping duplicates, or NULL if none */
+static forceinline struct ebvb_node *ebvb_prev_unique(struct ebvb_node *ebvb)
+{
+	return ebvb_entry(eb_prev_unique(&ebvb->node), struct ebvb_node, node);
+}
+
+/* Return the next node of cursor <cur>, or NULL if none */
+static inline struct ebvb_node *ebvb_cursor_next(struct eb_cursor *cur)
+{
+	return ebvb_entry(eb_cursor_next(cur), struct ebvb_node, node);
+}
+
+/* Delete node from the tree if it was linked in. Mark the node unused. Note
+ * that this function relies on a non-inlined generic function: eb_delete.
+ */
+static forceinline void ebvb_delete(struct ebvb_node *ebvb)
+{
+	eb_delete(&ebvb->node);
+}
+
+/* The following functions are not inlined by default. They are declared
+ * in ebvbtree.c, which simply relies on their inline version.
+ */
+struct ebvb_node *ebvb_lookup(struct eb_root *root, const void *x, unsigned int len);
+struct ebvb_node *ebvb_lookup_ge(struct eb_root *root, const void *x, unsigned int len);
+struct ebvb_node *ebvb_insert(struct eb_root *root, struct ebvb_node *new);
+int ebvb_prefix_cursor(struct eb_root *root, const void *x, unsigned int len,
+                       unsigned long limit, struct eb_cursor *cur);
+unsigned long ebvb_delete_prefix(struct eb_root *root, const void *x, unsigned int len,
+                                 void (*fn)(struct eb_node *node, void *arg), void *arg);
+
+/* The following functions are less likely to be used directly, because their
+ * code is larger. The non-inlined version is preferred.
+ */
+
+/* Return bit <bit> of the <len> bytes key <x>. Bit 0 of each 9-bit byte is one
+ * if the key holds this byte, and the 8 next ones are the byte's bits. All the
+ * bits past the key are zero.
+ */
+static forceinline int __ebvb_bit(const unsigned char *x, unsigned int len, int bit)
+{
+	unsigned int pos = (unsigned int)bit / 9;
+
+	bit -= pos * 9;
+	if (pos >= len)
+		return 0;
+	if (!bit)
+		return 1;
+	return (x[pos] >> (8 - bit)) & 1;
+}
+
+/* Return the number of equal bits between the <alen> bytes key <a> and the
+ * <blen> bytes key <b>, assuming that the first <ignore> bits are already
+ * identical, or -1 if both keys are the same.
+ */
+static forceinline int __ebvb_equal_bits(const unsigned char *a, unsigned int alen,
+                                         const unsigned char *b, unsigned int blen,
+                                         int ignore)
+{
+	unsigned int len = alen < blen ? alen : blen;
+	int bit;
+
+	bit = equal_bits(a, b, ((unsigned int)ignore / 9) << 3, len << 3);
+	if (bit < (int)(len << 3))
+		return (bit >> 3) * 9 + 1 + (bit & 7);
+	if (alen == blen)
+		return -1;
+	return len * 9;
+}
+
+/* Compare the <alen> bytes key <a> with the <blen> bytes key <b>, and return
+ * a negative, null or positive value depending on whether <a> sorts before,
+ * is equal to or sorts after <b>.
+ */
+static forceinline int __ebvb_cmp(const unsigned char *a, unsigned int alen,
+                                  const unsigned char *b, unsigned int blen)
+{
+	int ret = memcmp(a, b, alen < blen ? alen : blen);
+
+	if (ret)
+		return ret;
+	return (alen > blen) - (alen < blen);
+}
+
+/* Find the first occurence of the <len> bytes key <x> in the tree <root>.
+ * If none can be found, return NULL.
+ */
+static forceinline struct ebvb_node *__ebvb_lookup(struct eb_root *root, const void *x, unsigned int len)
+{
+	struct ebvb_node *node;
+	eb_troot_t *troot;
+	int node_bit;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	/* all the keys below a node share the bits before its own one, so we
+	 * can walk down to the only leaf or dup tree which may match, and
+	 * check the key there only.
+	 */
+	while (1) {
+		if (eb_gettag(troot) == EB_LEAF) {
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebvb_node, node.branches);
+			break;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebvb_node, node.branches);
+		node_bit = node->node.bit;
+		if (node_bit < 0) {
+			/* top of a dup tree, its leftmost leaf is the first
+			 * occurrence of its key.
+			 */
+			node = container_of(eb_walk_down(troot, EB_LEFT),
+					    struct ebvb_node, node);
+			break;
+		}
+		troot = node->node.branches.b[__ebvb_bit(x, len, node_bit)];
+	}
+
+	if (node->len != len || memcmp(node->key, x, len) != 0)
+		return NULL;
+	return node;
+}
+
+/* Find the first occurence of the lowest key in the tree <root> which is
+ * equal to or greater than the <len> bytes key <x>. If none can be found,
+ * return NULL.
+ */
+static forceinline struct ebvb_node *__ebvb_lookup_ge(struct eb_root *root, const void *x, unsigned int len)
+{
+	struct ebvb_node *node;
+	eb_troot_t *troot;
+	int node_bit;
+	int bit;
+
+	troot = root->b[EB_LEFT];
+	if (unlikely(troot == NULL))
+		return NULL;
+
+	bit = 0;
+	while (1) {
+		if ((eb_gettag(troot) == EB_LEAF)) {
+			/* We reached a leaf, which means that the whole upper
+			 * parts were common. We will return either the current
+			 * node or its next one if the former is too small.
+			 */
+			node = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebvb_node, node.branches);
+			if (__ebvb_cmp(node->key, node->len, x, len) >= 0)
+				return node;
+			/* return next */
+			troot = node->node.leaf_p;
+			break;
+		}
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebvb_node, node.branches);
+		node_bit = node->node.bit;
+
+		if (node_bit < 0) {
+			/* We're at the top of a dup tree. Either we got a
+			 * matching value and we return the leftmost node, or
+			 * we don't and we skip the whole subtree to return the
+			 * next node after the subtree.
+			 */
+			if (__ebvb_cmp(node->key, node->len, x, len) >= 0)
+				return container_of(eb_walk_down(troot, EB_LEFT),
+						    struct ebvb_node, node);
+			/* return next */
+			troot = node->node.node_p;
+			break;
+		}
+
+		/* As long as <x> matches the keys of the subtree on more bits
+		 * than the node's, there's no need to compare them again.
+		 */
+		if (bit >= 0 && bit < node_bit)
+			bit = __ebvb_equal_bits(x, len, node->key, node->len, bit);
+
+		if (bit >= 0 && bit < node_bit) {
+			/* No more common bits at all. Either this subtree is
+			 * too large and we need to get its lowest value, or it
+			 * is too small, and we need to get the next value.
+			 */
+			if (!__ebvb_bit(x, len, bit))
+				return container_of(eb_walk_down(troot, EB_LEFT),
+						    struct ebvb_node, node);
+			troot = node->node.node_p;
+			break;
+		}
+		troot = node->node.branches.b[__ebvb_bit(x, len, node_bit)];
+	}
+
+	/* If we get here, it means we want to report next node after the
+	 * current one which is not below. <troot> is already initialised
+	 * to the parent's branches.
+	 */
+	while (eb_gettag(troot) != EB_LEFT)
+		/* Walking up from right branch, so we cannot be below root */
+		troot = (eb_root_to_node(eb_untag(troot, EB_RGHT)))->node_p;
+
+	/* Note that <troot> cannot be NULL at this stage */
+	troot = (eb_untag(troot, EB_LEFT))->b[EB_RGHT];
+	if (eb_clrtag(troot) == NULL)
+		return NULL;
+
+	return container_of(eb_walk_down(troot, EB_LEFT), struct ebvb_node, node);
+}
+
+/* Return the subtree of tree <root> holding all the keys starting with the
+ * <len> bytes of <x>, or NULL if there are none. These keys share their first
+ * <len> 9-bit bytes, so this works the same way as __ebmb_prefix_subtree().
+ */
+static forceinline eb_troot_t *__ebvb_prefix_subtree(struct eb_root *root, const void *x, unsigned int len)
+{
+	struct ebvb_node *node;
+	eb_troot_t *troot;
+	int node_bit;
+
+	troot = root->b[EB_LEFT];
+	while (eb_gettag(troot) == EB_NODE) {
+		node = container_of(eb_untag(troot, EB_NODE),
+				    struct ebvb_node, node.branches);
+		node_bit = node->node.bit;
+		if (node_bit < 0 || node_bit >= (int)(len * 9))
+			break;
+		troot = node->node.branches.b[__ebvb_bit(x, len, node_bit)];
+	}
+
+	if (troot) {
+		/* any leaf of the subtree tells whether it matches */
+		node = container_of(eb_walk_down(troot, EB_LEFT), struct ebvb_node, node);
+		if (node->len < len || memcmp(node->key, x, len) != 0)
+			troot = NULL;
+	}
+	return troot;
+}
+
+/* Sets cursor <cur> to walk at most <limit> keys of tree <root> (all of them
+ * if <limit> is zero) starting with the <len> bytes of <x>, in ascending
+ * order. Returns non-zero if at least one key matches, otherwise zero with an
+ * empty cursor.
+ */
+static forceinline int __ebvb_prefix_cursor(struct eb_root *root, const void *x, unsigned int len,
+                                            unsigned long limit, struct eb_cursor *cur)
+{
+	eb_troot_t *troot = __ebvb_prefix_subtree(root, x, len);
+
+	eb_cursor_init(cur, troot, limit);
+	return troot != NULL;
+}
+
+/* Deletes all the keys of tree <root> starting with the <len> bytes of <x>,
+ * and passes their nodes in no particular order to <fn> with <arg> if <fn> is
+ * not NULL. Works like __ebmb_delete_prefix(). Returns the number of deleted
+ * keys.
+ */
+static forceinline unsigned long __ebvb_delete_prefix(struct eb_root *root, const void *x, unsigned int len,
+                                                      void (*fn)(struct eb_node *node, void *arg), void *arg)
+{
+	return eb_detach(__ebvb_prefix_subtree(root, x, len), fn, arg);
+}
+
+/* Insert ebvb_node <new> into subtree starting at node root <root>. Only
+ * new->key and new->len need be set, the length being at most EBVB_MAX_LEN.
+ * The ebvb_node is returned. If root->b[EB_RGHT]==1, the tree may only
+ * contain unique keys, and the node already holding the key is returned
+ * instead if there is one.
+ */
+static forceinline struct ebvb_node *
+__ebvb_insert(struct eb_root *root, struct ebvb_node *new)
+{
+	struct ebvb_node *old;
+	unsigned int side;
+	eb_troot_t *troot;
+	eb_troot_t *root_right;
+	int bit;
+	int old_node_bit;
+
+	side = EB_LEFT;
+	troot = root->b[EB_LEFT];
+	root_right = root->b[EB_RGHT];
+	if (unlikely(troot == NULL)) {
+		/* Tree is empty, insert the leaf part below the left branch */
+		root->b[EB_LEFT] = eb_dotag(&new->node.branches, EB_LEAF);
+		new->node.leaf_p = eb_dotag(root, EB_LEFT);
+		new->node.node_p = NULL; /* node part unused */
+		return new;
+	}
+
+	/* The descent is the same as in __ebst_insert(), only the bits are
+	 * compared differently.
+	 */
+	bit = 0;
+	while (1) {
+		if (unlikely(eb_gettag(troot) == EB_LEAF)) {
+			eb_troot_t *new_left, *new_rght;
+			eb_troot_t *new_leaf, *old_leaf;
+
+			old = container_of(eb_untag(troot, EB_LEAF),
+					    struct ebvb_node, node.branches);
+
+			new_left = eb_dotag(&new->node.branches, EB_LEFT);
+			new_rght = eb_dotag(&new->node.branches, EB_RGHT);
+			new_leaf = eb_dotag(&new->node.branches, EB_LEAF);
+			old_leaf = eb_dotag(&old->node.branches, EB_LEAF);
+
+			new->node.node_p = old->node.leaf_p;
+
+			if (bit >= 0)
+				bit = __ebvb_equal_bits(new->key, new->len, old->key, old->len, bit);
+
+			if (bit < 0) {
+				/* key was already there */
+
+				/* we may refuse to duplicate this key if the tree is
+				 * tagged as containing only unique keys.
+				 */
+				if (eb_gettag(root_right))
+					return old;
+
+				/* new arbitrarily goes to the right and tops the dup tree */
+				old->node.leaf_p = new_left;
+				new->node.leaf_p = new_rght;
+				new->node.branches.b[EB_LEFT] = old_leaf;
+				new->node.branches.b[EB_RGHT] = new_leaf;
+				new->node.bit = -1;
+				root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+				return new;
+			}
+
+			if (!__ebvb_bit(new->key, new->len, bit)) {
+				/* new->key < old->key, new takes the left */
+				new->node.leaf_p = new_left;
+				old->node.leaf_p = new_rght;
+				new->node.branches.b[EB_LEFT] = new_leaf;
+				new->node.branches.b[EB_RGHT] = old_leaf;
+			} else {
+				/* new->key > old->key, new takes the right */
+				old->node.leaf_p = new_left;
+				new->node.leaf_p = new_rght;
+				new->node.branches.b[EB_LEFT] = old_leaf;
+				new->node.branches.b[EB_RGHT] = new_leaf;
+			}
+			break;
+		}
+
+		/* OK we're walking down this link */
+		old = container_of(eb_untag(troot, EB_NODE),
+				   struct ebvb_node, node.branches);
+		old_node_bit = old->node.bit;
+
+		/* Stop going down when we don't have common bits anymore. We
+		 * also stop in front of a duplicates tree because it means we
+		 * have to insert above.
+		 */
+		if (bit >= 0 && (bit < old_node_bit || old_node_bit < 0))
+			bit = __ebvb_equal_bits(new->key, new->len, old->key, old->len, bit);
+
+		if (unlikely(bit < 0)) {
+			/* Perfect match, we must only stop on head of dup tree
+			 * or walk down to a leaf.
+			 */
+			if (old_node_bit < 0) {
+				struct eb_node *ret;
+				ret = eb_insert_dup(&old->node, &new->node);
+				return container_of(ret, struct ebvb_node, node);
+			}
+			/* OK so let's walk down */
+		}
+		else if (bit < old_node_bit || old_node_bit < 0) {
+			/* The tree did not contain the key, or we stopped on
+			 * top of a dup tree not holding it. We insert <new>
+			 * before the node <old>.
+			 */
+			eb_troot_t *new_left, *new_rght;
+			eb_troot_t *new_leaf, *old_node;
+
+			new_left = eb_dotag(&new->node.branches, EB_LEFT);
+			new_rght = eb_dotag(&new->node.branches, EB_RGHT);
+			new_leaf = eb_dotag(&new->node.branches, EB_LEAF);
+			old_node = eb_dotag(&old->node.branches, EB_NODE);
+
+			new->node.node_p = old->node.node_p;
+
+			if (!__ebvb_bit(new->key, new->len, bit)) {
+				new->node.leaf_p = new_left;
+				old->node.node_p = new_rght;
+				new->node.branches.b[EB_LEFT] = new_leaf;
+				new->node.branches.b[EB_RGHT] = old_node;
+			}
+			else {
+				old->node.node_p = new_left;
+				new->node.leaf_p = new_rght;
+				new->node.branches.b[EB_LEFT] = old_node;
+				new->node.branches.b[EB_RGHT] = new_leaf;
+			}
+			break;
+		}
+
+		/* walk down */
+		root = &old->node.branches;
+		side = __ebvb_bit(new->key, new->len, old_node_bit);
+		troot = root->b[side];
+	}
+
+	/* Ok, now we are inserting <new> between <root> and <old>. <old>'s
+	 * parent is already set to <new>, and the <root>'s branch is still in
+	 * <side>. The number of common bits between new->key and old->key is
+	 * already in <bit>.
+	 */
+	new->node.bit = bit;
+	root->b[side] = eb_dotag(&new->node.branches, EB_NODE);
+	return new;
+}
+
+#endif /* _EBVBTREE_H */
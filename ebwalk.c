@@ -0,0 +1,224 @@
+/*
+ * Elastic Binary Trees - parallel walk over disjoint key ranges.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Consult ebwalk.h for more details about those functions */
+
+#include <pthread.h>
+#include <string.h>
+#include "ebwalk.h"
+
+/* What the workers have to do on each range */
+#define EB_WALK_FOREACH	0
+#define EB_WALK_COUNT	1
+#define EB_WALK_EXPORT	2
+
+/* Context shared by all the workers of a parallel walk */
+struct eb_walk_ctx {
+	struct eb_range ranges[EB_WALK_MAX_RANGES];
+	unsigned long counts[EB_WALK_MAX_RANGES]; /* leaves (or output offset) per range */
+	int nbranges;
+	int next;               /* next range to be picked, atomically updated */
+	int task;               /* EB_WALK_* */
+	int (*fn)(struct eb_node *node, int range, void *arg);
+	void *arg;
+	struct eb_node **out;   /* output array for EB_WALK_EXPORT */
+};
+
+/* Splits the tree starting at <root> into at most <max> contiguous ranges of
+ * leaves which are stored into <ranges> in ascending key order. Nodes are
+ * split level by level from the top, so that ranges roughly cover the same
+ * number of bits. Returns the number of ranges, which is zero for an empty
+ * tree and may be lower than <max> for small trees.
+ */
+int eb_split(struct eb_root *root, struct eb_range *ranges, int max)
+{
+	eb_troot_t *sub[EB_WALK_MAX_RANGES];
+	struct eb_root *node;
+	int nb, i, split;
+
+	if (max > EB_WALK_MAX_RANGES)
+		max = EB_WALK_MAX_RANGES;
+
+	if (unlikely(root->b[EB_LEFT] == NULL) || max <= 0)
+		return 0;
+
+	sub[0] = root->b[EB_LEFT];
+	nb = 1;
+	do {
+		/* replace each node with its two branches, left one first */
+		split = 0;
+		for (i = 0; i < nb && nb < max; i++) {
+			if (eb_gettag(sub[i]) != EB_NODE)
+				continue;
+			node = eb_untag(sub[i], EB_NODE);
+			memmove(&sub[i + 2], &sub[i + 1], (nb - i - 1) * sizeof(*sub));
+			sub[i] = node->b[EB_LEFT];
+			sub[i + 1] = node->b[EB_RGHT];
+			nb++;
+			i++;
+			split = 1;
+		}
+	} while (split && nb < max);
+
+	for (i = 0; i < nb; i++) {
+		ranges[i].first = eb_walk_down(sub[i], EB_LEFT);
+		ranges[i].last  = eb_walk_down(sub[i], EB_RGHT);
+	}
+	return nb;
+}
+
+/* Picks ranges from <arg> until none is left and processes them */
+static void *eb_walk_worker(void *arg)
+{
+	struct eb_walk_ctx *ctx = arg;
+	struct eb_node *node;
+	unsigned long cnt;
+	int range;
+
+	while ((range = __atomic_fetch_add(&ctx->next, 1, __ATOMIC_RELAXED)) < ctx->nbranges) {
+		node = ctx->ranges[range].first;
+		switch (ctx->task) {
+		case EB_WALK_FOREACH:
+			while (node && !ctx->fn(node, range, ctx->arg))
+				node = eb_range_next(&ctx->ranges[range], node);
+			break;
+		case EB_WALK_COUNT:
+			for (cnt = 0; node; cnt++)
+				node = eb_range_next(&ctx->ranges[range], node);
+			ctx->counts[range] = cnt;
+			break;
+		case EB_WALK_EXPORT:
+			/* counts[] holds this range's offset in the output */
+			for (cnt = ctx->counts[range]; node; cnt++) {
+				ctx->out[cnt] = node;
+				node = eb_range_next(&ctx->ranges[range], node);
+			}
+			break;
+		}
+	}
+	return NULL;
+}
+
+/* Runs task <task> over all ranges of <ctx> using <threads> threads including
+ * the calling one. Threads which cannot be created are simply not used.
+ */
+static void eb_walk_run(struct eb_walk_ctx *ctx, int task, int threads)
+{
+	pthread_t thr[EB_WALK_MAX_RANGES];
+	int i, started;
+
+	ctx->task = task;
+	ctx->next = 0;
+
+	if (threads > ctx->nbranges)
+		threads = ctx->nbranges;
+
+	for (started = 0; started < threads - 1; started++)
+		if (pthread_create(&thr[started], NULL, eb_walk_worker, ctx) != 0)
+			break;
+
+	eb_walk_worker(ctx);
+
+	for (i = 0; i < started; i++)
+		pthread_join(thr[i], NULL);
+}
+
+/* Prepares context <ctx> for a walk over tree <root> using <threads> threads.
+ * Returns the number of ranges, or zero if the tree is empty.
+ */
+static int eb_walk_prepare(struct eb_walk_ctx *ctx, struct eb_root *root, int threads)
+{
+	if (threads < 1)
+		threads = 1;
+	ctx->nbranges = eb_split(root, ctx->ranges, threads * EB_WALK_RANGES_PER_THREAD);
+	return ctx->nbranges;
+}
+
+/* Calls <fn> for each leaf of tree <root> using <threads> threads. Within a
+ * range, leaves are visited in ascending order, but ranges are processed in
+ * parallel. <fn> receives the leaf, the range number (ranges are numbered in
+ * ascending key order) and <arg>. If it returns non-zero, the rest of this
+ * range is skipped. Returns the number of ranges.
+ */
+int eb_parallel_foreach(struct eb_root *root, int threads,
+			int (*fn)(struct eb_node *node, int range, void *arg), void *arg)
+{
+	struct eb_walk_ctx ctx;
+
+	if (!eb_walk_prepare(&ctx, root, threads))
+		return 0;
+	ctx.fn = fn;
+	ctx.arg = arg;
+	eb_walk_run(&ctx, EB_WALK_FOREACH, threads);
+	return ctx.nbranges;
+}
+
+/* Returns the number of leaves in tree <root>, counted using <threads> threads */
+unsigned long eb_parallel_count(struct eb_root *root, int threads)
+{
+	struct eb_walk_ctx ctx;
+	unsigned long total;
+	int i;
+
+	if (!eb_walk_prepare(&ctx, root, threads))
+		return 0;
+	eb_walk_run(&ctx, EB_WALK_COUNT, threads);
+	for (total = i = 0; i < ctx.nbranges; i++)
+		total += ctx.counts[i];
+	return total;
+}
+
+/* Stores pointers to all leaves of tree <root> in ascending order into array
+ * <out> which has room for <max> entries, using <threads> threads. Leaves are
+ * first counted per range so that each range knows where to store its leaves,
+ * then all ranges are exported in parallel. Returns the number of leaves in
+ * the tree. If it is larger than <max>, nothing is stored.
+ */
+unsigned long eb_parallel_export(struct eb_root *root, int threads,
+				 struct eb_node **out, unsigned long max)
+{
+	struct eb_walk_ctx ctx;
+	unsigned long total, cnt;
+	int i;
+
+	if (!eb_walk_prepare(&ctx, root, threads))
+		return 0;
+	eb_walk_run(&ctx, EB_WALK_COUNT, threads);
+
+	/* turn the counts into offsets */
+	for (total = i = 0; i < ctx.nbranges; i++) {
+		cnt = ctx.counts[i];
+		ctx.counts[i] = total;
+		total += cnt;
+	}
+
+	if (total > max)
+		return total;
+
+	ctx.out = out;
+	eb_walk_run(&ctx, EB_WALK_EXPORT, threads);
+	return total;
+}
@@ -0,0 +1,74 @@
+/*
+ * Elastic Binary Trees - parallel walk over disjoint key ranges.
+ *
+ * Copyright (C) 2000-2015 Willy Tarreau - w@1wt.eu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* All leaves found below the left branch of a node are sorted before those
+ * found below its right branch, whatever the tree type. So by descending the
+ * first levels of a tree, we can cut it into a number of subtrees, each of
+ * which covers a contiguous key range, and the ranges are themselves sorted.
+ * Each range is then described by its first and last leaves, and may be
+ * walked with eb_next() independently of the other ones. These functions
+ * work on the generic eb_node, so they apply to all tree types. The tree must
+ * not be modified while it is being walked.
+ */
+
+#ifndef _EBWALK_H
+#define _EBWALK_H
+
+#include "ebtree.h"
+
+/* Max number of ranges a tree may be split into */
+#define EB_WALK_MAX_RANGES	1024
+
+/* Number of ranges per thread used by the parallel functions below, so that
+ * threads which complete small ranges early may pick another one.
+ */
+#define EB_WALK_RANGES_PER_THREAD	8
+
+/* A contiguous range of leaves */
+struct eb_range {
+	struct eb_node *first; /* first leaf of the range */
+	struct eb_node *last;  /* last leaf of the range */
+};
+
+/* Return the leaf following <node> in range <range>, or NULL if <node> was the
+ * last one.
+ */
+static inline struct eb_node *eb_range_next(const struct eb_range *range, struct eb_node *node)
+{
+	if (node == range->last)
+		return NULL;
+	return eb_next(node);
+}
+
+/* The following functions are not inlined. They are declared in ebwalk.c. */
+int eb_split(struct eb_root *root, struct eb_range *ranges, int max);
+int eb_parallel_foreach(struct eb_root *root, int threads,
+			int (*fn)(struct eb_node *node, int range, void *arg), void *arg);
+unsigned long eb_parallel_count(struct eb_root *root, int threads);
+unsigned long eb_parallel_export(struct eb_root *root, int threads,
+				 struct eb_node **out, unsigned long max);
+
+#endif /* _EBWALK_H */
@@ -27,138 +27,149 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
-#include <ebmbtree.h>
+#include <ebcidr.h>
 
-struct one_net {
-	struct ebmb_node eb_node;
-	struct in_addr addr; /* keep it after eb_node */
-	/* any other information related to this network could be stored here */
-};
+/* size of the chunks read from non-regular files */
+#define CHUNK_SIZE	(1024 * 1024)
 
-struct eb_root tree = EB_ROOT;  /* EB_ROOT || EB_ROOT_UNIQUE */
+struct ebcidr set;
+unsigned long nets, bad, bytes;
 
-/* Insert an address into the tree, after checking that it does not match
- * another one. If it does, then only one is kept or they are merged in a
- * larger network and the function recurses over itself. The address is in
- * network byte order.
+/* Loads the networks from file descriptor <fd>. Regular files are mapped at
+ * once, other ones are read by chunks, keeping the trailing partial line for
+ * the next chunk. Returns zero on error.
  */
-void insert_net(unsigned addr, unsigned cidr)
+int load_fd(int fd)
 {
-	unsigned mask;
-	struct ebmb_node *node;
-	struct one_net *net;
-
-	/* clear unexpected bits */
-	mask = cidr ? ((signed)-0x80000000) >> (cidr - 1) : 0;
-	mask = htonl(mask);
-	addr &= mask;
-
-	/* 1) check if the entry already exists or matches an existing one. If we
-	 * get a match, we have to compare prefixes and keep the widest one.
-	 */
-	if ((node = ebmb_lookup_longest(&tree, &addr)) != NULL) {
-		if (node->node.pfx <= cidr)
-			return;
-		ebmb_delete(node);
-		free(node);
-	}
-
-	/* 2) check if we can merge this network with the one just below or above */
-	if (cidr) {
-		unsigned mask2, addr2;
-		mask2 = cidr ? ((unsigned)0x80000000U) >> (cidr - 1) : 0;
-		mask2 = htonl(mask2);
-
-		/* invert the bit corresponding to the mask */
-		addr2 = addr ^ mask2;
-		node = ebmb_lookup_prefix(&tree, &addr2, cidr);
-
-		if (node) {
-			/* we can merge both entries at cidr - 1 */
-			ebmb_delete(node);
-			free(ebmb_entry(node, struct one_net, eb_node));
-			addr &= addr2; /* clear varying bit */
-			cidr--;
-			/* recursively do the same above */
-			insert_net(addr, cidr);
-			return;
+	struct stat st;
+	char *buf, *nl;
+	size_t len;
+	ssize_t ret;
+	void *map;
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			madvise(map, st.st_size, MADV_SEQUENTIAL);
+			nets += ebcidr_add_text(&set, map, st.st_size, &bad);
+			bytes += st.st_size;
+			munmap(map, st.st_size);
+			return 1;
 		}
 	}
 
-	net = (struct one_net *)calloc(1, sizeof(*net));
-	net->addr.s_addr = addr;
-	net->eb_node.node.pfx = cidr;
-	ebmb_insert_prefix(&tree, &net->eb_node, sizeof(net->addr.s_addr));
-
-	/* 3) it is possible that this node covers other ones. All other ones
-	 * will always be located just after this one, so let's walk right as
-	 * long as we find some matches and kill them.
-	 */
-	node = ebmb_next(&net->eb_node);
-	while (node) {
-		net = ebmb_entry(node, struct one_net, eb_node);
-		if ((addr & mask) != (net->addr.s_addr & mask))
-			break;
-		node = ebmb_next(&net->eb_node);
-		ebmb_delete(&net->eb_node);
-	}
-
-}
-
-void read_nets_from_stdin()
-{
-	struct in_addr addr;
-	char str[256];
-	char *slash;
-	int bits;
-
-	while (fgets(str, sizeof(str), stdin) != NULL) {
-		bits = 32;
-		slash = strchr(str, '/');
-		if (slash) {
-			*(slash++) = 0;
-			if (strchr(slash, '.') == NULL) {
-				bits = atoi(slash);
-			} else {
-				inet_aton(slash, &addr);
-				bits = htonl(addr.s_addr);
-				if (bits)
-					bits = 32 - flsnz(~bits);
-			}
+	buf = malloc(CHUNK_SIZE);
+	if (!buf)
+		return 0;
+
+	len = 0;
+	while ((ret = read(fd, buf + len, CHUNK_SIZE - len)) > 0) {
+		len += ret;
+		bytes += ret;
+		for (nl = buf + len; nl > buf && nl[-1] != '\n'; nl--)
+			;
+		if (nl == buf) {
+			if (len < CHUNK_SIZE)
+				continue;
+			/* no line fits in a chunk, drop it */
+			bad++;
+			len = 0;
+			continue;
 		}
-		inet_aton(str, &addr);
-		insert_net(addr.s_addr, bits);
+		nets += ebcidr_add_text(&set, buf, nl - buf, &bad);
+		len -= nl - buf;
+		memmove(buf, nl, len);
 	}
+	nets += ebcidr_add_text(&set, buf, len, &bad);
+	free(buf);
+	return ret == 0;
 }
 
 void dump_nets()
 {
-	struct ebmb_node *node = ebmb_first(&tree);
+	struct ebmb_node *node;
+	char str[INET6_ADDRSTRLEN];
 
-	while (node) {
+	for (node = ebmb_first(&set.net4); node; node = ebmb_next(node))
 		printf("%d.%d.%d.%d/%d\n",
 		       node->key[0], node->key[1], node->key[2], node->key[3], node->node.pfx);
-		node = ebmb_next(node);
-		if (!node)
-			break;
+
+	for (node = ebmb_first(&set.net6); node; node = ebmb_next(node)) {
+		inet_ntop(AF_INET6, node->key, str, sizeof(str));
+		printf("%s/%d\n", str, node->node.pfx);
 	}
 }
 
 int main(int argc, char **argv)
 {
-	if (argc > 1) {
+	struct timespec t0, t1;
+	double elapsed;
+	int verbose = 0;
+	int i, fd;
+
+	if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+		verbose = 1;
+		argc--; argv++;
+	}
+
+	if (argc > 1 && *argv[1] == '-' && argv[1][1]) {
 		fprintf(stderr,
-			"Enter networks one per line in the form <net>[/<mask>]\n"
-			"The output will contain the smallest reduction of these nets.\n"
+			"Usage: reduce [-v] [file...]\n"
+			"Enter IPv4 or IPv6 networks one per line in the form <net>[/<mask>]\n"
+			"in the files or on stdin. The output will contain the smallest\n"
+			"reduction of these nets. -v reports statistics on stderr.\n"
 			);
 		exit(1);
 	}
-	read_nets_from_stdin();
+
+	if (!ebcidr_init(&set)) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 1; i < argc || i == 1; i++) {
+		if (i >= argc || strcmp(argv[i], "-") == 0)
+			fd = 0;
+		else if ((fd = open(argv[i], O_RDONLY)) < 0) {
+			perror(argv[i]);
+			exit(1);
+		}
+		if (!load_fd(fd)) {
+			fprintf(stderr, "Failed to read %s\n", i < argc ? argv[i] : "stdin");
+			exit(1);
+		}
+		if (fd)
+			close(fd);
+	}
+
+	if (!ebcidr_flush(&set)) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	setvbuf(stdout, NULL, _IOFBF, 65536);
 	dump_nets();
+
+	if (verbose) {
+		elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+		if (elapsed <= 0)
+			elapsed = 1e-9;
+		fprintf(stderr,
+			"%lu networks read (%lu invalid lines), %lu IPv4 and %lu IPv6 left, "
+			"%.3f s, %.2f M networks/s, %.1f MB/s\n",
+			nets, bad, set.nb4, set.nb6, elapsed,
+			nets / elapsed / 1e6, bytes / elapsed / 1e6);
+	}
 	return 0;
 }
@@ -24,101 +24,370 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
+/* Outputs the lines of Squid access logs whose URL (7th field) is one of those
+ * of a list, as fast as possible on multi-GB logs. Regular files are mapped at
+ * once, other inputs are read into memory first. The input is then cut into
+ * one chunk per thread on line boundaries, and each thread looks up its URLs
+ * by batches with ebst_lookup_batch(), so that the cache misses of several
+ * lookups overlap. Matching lines are reported in input order.
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <ebsttree.h>
 
+/* size of the chunks read from non-regular files */
+#define CHUNK_SIZE	(1024 * 1024)
+
+/* number of URLs looked up at once */
+#define BATCH		64
+
+/* max number of threads */
+#define MAX_THREADS	256
+
 struct eb_root tree = EB_ROOT_UNIQUE;  /* EB_ROOT || EB_ROOT_UNIQUE */
 
-int input, match;
+/* an input file in memory */
+struct input {
+	char *data;
+	size_t size;
+	int mapped;
+};
 
-void insert_url(const char *url)
+/* the part of the input processed by one thread, and its results */
+struct worker {
+	pthread_t thread;
+	const char *beg, *end;      /* lines to process */
+	const char **match;         /* start of matching lines */
+	unsigned long nbmatch;      /* number of matching lines */
+	unsigned long maxmatch;     /* room in <match> */
+	unsigned long input;        /* number of lines with a URL */
+};
+
+/* Loads file descriptor <fd> into <in>. Regular files are mapped, other ones
+ * are read by chunks. Returns zero on error.
+ */
+int load_fd(int fd, struct input *in)
 {
-	struct ebmb_node *node;
-	int l;
-
-	l = strlen(url);
-	while (l && url[l-1] == '\n')
-		l--;
-	node = calloc(1, sizeof(*node) + l + 1);
-	memcpy(node->key, url, l);
-	node->key[l] = 0;
-	ebst_insert(&tree, node);
+	struct stat st;
+	size_t room;
+	ssize_t ret;
+	char *buf;
+
+	in->data = NULL;
+	in->size = 0;
+	in->mapped = 0;
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		if (!st.st_size)
+			return 1;
+		in->data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (in->data != MAP_FAILED) {
+			madvise(in->data, st.st_size, MADV_SEQUENTIAL);
+			in->size = st.st_size;
+			in->mapped = 1;
+			return 1;
+		}
+		in->data = NULL;
+	}
+
+	room = 0;
+	do {
+		if (in->size == room) {
+			room += CHUNK_SIZE;
+			buf = realloc(in->data, room);
+			if (!buf)
+				return 0;
+			in->data = buf;
+		}
+		ret = read(fd, in->data + in->size, room - in->size);
+		if (ret > 0)
+			in->size += ret;
+	} while (ret > 0);
+	return ret == 0;
 }
 
-void read_urls_from_file(FILE *f)
+void release(struct input *in)
 {
-	char str[256];
+	if (in->mapped)
+		munmap(in->data, in->size);
+	else
+		free(in->data);
+}
 
-	while (fgets(str, sizeof(str), f) != NULL)
-		insert_url(str);
+/* Inserts the URLs found one per line in <in>. All nodes are allocated at
+ * once since they are never released. Returns the number of distinct URLs.
+ */
+unsigned long insert_urls(const struct input *in)
+{
+	const char *p, *end, *nl;
+	struct ebmb_node *node;
+	unsigned long nb = 0;
+	size_t lines = 1, l;
+	char *area;
+
+	for (p = in->data, end = p + in->size; (p = memchr(p, '\n', end - p)); p++)
+		lines++;
+
+	/* one node per line, each one aligned on a pointer */
+	area = malloc(in->size + lines * (sizeof(*node) + sizeof(void *)));
+	if (!area) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	for (p = in->data; p < end; p = nl + 1) {
+		nl = memchr(p, '\n', end - p);
+		if (!nl)
+			nl = end;
+		l = nl - p;
+		if (l && p[l - 1] == '\r')
+			l--;
+		if (!l)
+			continue;
+		node = (struct ebmb_node *)area;
+		memcpy(node->key, p, l);
+		node->key[l] = 0;
+		if (ebst_insert(&tree, node) != node)
+			continue;
+		area += (sizeof(*node) + l + sizeof(void *)) & -sizeof(void *);
+		nb++;
+	}
+	return nb;
 }
 
-void match_logs_from_stdin()
+/* Returns the URL of line <line> ending at <eol>, and its length in <len>, or
+ * NULL if there is none.
+ */
+const char *find_url(const char *line, const char *eol, size_t *len)
 {
+	const char *url = line, *end;
 	int field;
-	char line[256];
-	char *str, *url, *end;
-	struct ebmb_node *node;
 
-	match = 0; input = 0;
-	/* Note: this construct allows easier use of halog's fgets() */
-	while ((str = fgets(line, sizeof(line), stdin)) != NULL) {
-		/* URL is on the 7th field */
-		url = str;
-		for (field = 0; field < 6; field++) {
-			while (*url && *url != ' ')
-				url++;
-			while (*url == ' ')
-				url++;
+	for (field = 0; field < 6; field++) {
+		while (url < eol && *url != ' ')
+			url++;
+		while (url < eol && *url == ' ')
+			url++;
+	}
+
+	for (end = url; end < eol && *end != ' '; end++)
+		;
+	*len = end - url;
+	return end > url ? url : NULL;
+}
+
+/* Looks up the <nb> URLs stored at offsets <offs> of <buf>, and records which
+ * of <lines> matched.
+ */
+void lookup_batch(struct worker *w, const char *buf, const size_t *offs, const char **lines, int nb)
+{
+	struct ebmb_node *res[BATCH];
+	const char *keys[BATCH];
+	const char **match;
+	int i;
+
+	for (i = 0; i < nb; i++)
+		keys[i] = buf + offs[i];
+
+	ebst_lookup_batch(&tree, keys, nb, res);
+	for (i = 0; i < nb; i++) {
+		if (!res[i])
+			continue;
+		if (w->nbmatch == w->maxmatch) {
+			w->maxmatch = w->maxmatch ? w->maxmatch * 2 : 1024;
+			match = realloc(w->match, w->maxmatch * sizeof(*match));
+			if (!match) {
+				fprintf(stderr, "Out of memory\n");
+				exit(1);
+			}
+			w->match = match;
 		}
+		w->match[w->nbmatch++] = lines[i];
+	}
+}
+
+/* Processes the lines of worker <arg>. URLs are copied to a local buffer to
+ * be zero-terminated, since the input may be read-only.
+ */
+void *match_lines(void *arg)
+{
+	struct worker *w = arg;
+	const char *lines[BATCH];
+	const char *line, *eol, *url;
+	size_t offs[BATCH];
+	size_t len, used = 0, room = 0;
+	char *buf = NULL;
+	int nb = 0;
 
-		end = url;
-		while (*end && *end != ' ')
-			end++;
-		*end = 0;
+	for (line = w->beg; line < w->end; line = eol + 1) {
+		eol = memchr(line, '\n', w->end - line);
+		if (!eol)
+			eol = w->end;
 
-		if (end == url)
+		url = find_url(line, eol, &len);
+		if (!url)
 			continue;
+		w->input++;
 
-		input++;
-		node = ebst_lookup(&tree, url);
-		if (node) {
-			match++;
-			puts(str);
+		if (used + len + 1 > room) {
+			room = (used + len + 1) * 2 + 4096;
+			buf = realloc(buf, room);
+			if (!buf) {
+				fprintf(stderr, "Out of memory\n");
+				exit(1);
+			}
+		}
+		memcpy(buf + used, url, len);
+		buf[used + len] = 0;
+		offs[nb] = used;
+		lines[nb++] = line;
+		used += len + 1;
+
+		if (nb == BATCH) {
+			lookup_batch(w, buf, offs, lines, nb);
+			nb = 0;
+			used = 0;
 		}
 	}
+	if (nb)
+		lookup_batch(w, buf, offs, lines, nb);
+	free(buf);
+	return NULL;
+}
+
+/* Matches all lines of <in> using <threads> threads, and outputs the matching
+ * lines unless <quiet> is set. Returns the number of matching lines, and
+ * adds the number of lines with a URL to <input>.
+ */
+unsigned long match_input(const struct input *in, int threads, int quiet, unsigned long *input)
+{
+	struct worker w[MAX_THREADS];
+	const char *p, *end = in->data + in->size, *eol;
+	unsigned long nbmatch = 0, i;
+	int t;
+
+	/* cut the input on line boundaries */
+	p = in->data;
+	for (t = 0; t < threads; t++) {
+		memset(&w[t], 0, sizeof(w[t]));
+		w[t].beg = p;
+		p = in->data + in->size / threads * (t + 1);
+		if (t == threads - 1 || p < w[t].beg)
+			p = end;
+		else if ((p = memchr(p, '\n', end - p)) != NULL)
+			p++;
+		else
+			p = end;
+		w[t].end = p;
+	}
+
+	for (t = 1; t < threads; t++) {
+		if (pthread_create(&w[t].thread, NULL, match_lines, &w[t]) != 0) {
+			perror("pthread_create");
+			exit(1);
+		}
+	}
+	match_lines(&w[0]);
+
+	for (t = 0; t < threads; t++) {
+		if (t)
+			pthread_join(w[t].thread, NULL);
+		*input += w[t].input;
+		nbmatch += w[t].nbmatch;
+		for (i = 0; !quiet && i < w[t].nbmatch; i++) {
+			eol = memchr(w[t].match[i], '\n', end - w[t].match[i]);
+			if (!eol)
+				eol = end;
+			fwrite(w[t].match[i], 1, eol - w[t].match[i], stdout);
+			putchar('\n');
+		}
+		free(w[t].match);
+	}
+	return nbmatch;
 }
 
 int main(int argc, char **argv)
 {
-	FILE *f;
-	int matches;
+	struct timespec t0, t1;
+	struct input in;
+	unsigned long urls, match = 0, input = 0;
+	double elapsed, bytes = 0;
+	int threads, quiet = 0;
+	int i, fd;
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	while (argc > 1 && *argv[1] == '-') {
+		if (strcmp(argv[1], "-q") == 0)
+			quiet = 1;
+		else if (strcmp(argv[1], "-t") == 0 && argc > 2) {
+			threads = atoi(argv[2]);
+			argc--; argv++;
+		}
+		else
+			break;
+		argc--; argv++;
+	}
 
-	if (argc != 2) {
+	if (argc < 2 || *argv[1] == '-') {
 		fprintf(stderr,
 			"Usage:\n"
-			"  $0 url_file < squid_access.log\n"
-			"  Will output all lines referencing one of the URLs from url_file.\n"
+			"  $0 [-q] [-t threads] url_file [squid_access.log...]\n"
+			"  Will output all lines referencing one of the URLs from url_file,\n"
+			"  from the logs or stdin. -q only reports the number of matches.\n"
 			);
 		exit(1);
 	}
 
-	f = fopen(argv[1], "r");
-	if (!f) {
-		perror("fopen");
+	if (threads < 1)
+		threads = 1;
+	if (threads > MAX_THREADS)
+		threads = MAX_THREADS;
+
+	if ((fd = open(argv[1], O_RDONLY)) < 0) {
+		perror(argv[1]);
+		exit(1);
+	}
+	if (!load_fd(fd, &in)) {
+		fprintf(stderr, "Failed to read %s\n", argv[1]);
 		exit(1);
 	}
-	read_urls_from_file(f);
-	fclose(f);
+	close(fd);
+	urls = insert_urls(&in);
+	release(&in);
+
+	setvbuf(stdout, NULL, _IOFBF, 65536);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 2; i < argc || i == 2; i++) {
+		if (i >= argc || strcmp(argv[i], "-") == 0)
+			fd = 0;
+		else if ((fd = open(argv[i], O_RDONLY)) < 0) {
+			perror(argv[i]);
+			exit(1);
+		}
+		if (!load_fd(fd, &in)) {
+			fprintf(stderr, "Failed to read %s\n", i < argc ? argv[i] : "stdin");
+			exit(1);
+		}
+		if (fd)
+			close(fd);
+		match += match_input(&in, threads, quiet, &input);
+		bytes += in.size;
+		release(&in);
+	}
+	fflush(stdout);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
 
-	match_logs_from_stdin();
-	fprintf(stderr, "Matches: %d/%d\n", match, input);
+	elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	fprintf(stderr, "Matches: %lu/%lu (%lu URLs), %.3f GB in %.3f s, %.2f GB/s\n",
+		match, input, urls, bytes / 1e9, elapsed, elapsed > 0 ? bytes / 1e9 / elapsed : 0.0);
 	return 0;
 }
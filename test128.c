@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "eb128tree.h"
+
+#ifdef __SIZEOF_INT128__
+
+#ifdef DEBUG
+#define DPRINTF printf
+#else
+#define DPRINTF(a, ...)
+#endif
+
+/* converts IPv6 address <str> to a 128-bit key. Returns 0 on error. */
+static int str2key(const char *str, u128 *key)
+{
+	unsigned char addr[16];
+	int i;
+
+	if (inet_pton(AF_INET6, str, addr) != 1)
+		return 0;
+	for (*key = 0, i = 0; i < 16; i++)
+		*key = (*key << 8) | addr[i];
+	return 1;
+}
+
+/* returns a static string holding key <key> as an IPv6 address */
+static const char *key2str(u128 key)
+{
+	static char str[INET6_ADDRSTRLEN];
+	unsigned char addr[16];
+	int i;
+
+	for (i = 15; i >= 0; i--, key >>= 8)
+		addr[i] = key;
+	return inet_ntop(AF_INET6, addr, str, sizeof(str));
+}
+
+int main(int argc, char **argv) {
+	u128 x;
+	struct eb_root e128 = EB_ROOT;
+	struct eb128_node *node;
+	char buffer[1024];
+	char *slash;
+	int prefix = 0;
+
+	/* disable output buffering */
+	setbuf(stdout, NULL);
+
+	if (argc > 1 && strcmp(argv[1], "-h") == 0) {
+		fprintf(stderr, "Usage: %s [-p] [addr[/pfx]...]\n"
+			"  -p : build a prefix tree and look up longest matches\n", argv[0]);
+		exit(1);
+	}
+
+	argv++;	argc--;
+	if (argc >= 1 && strcmp(*argv, "-p") == 0) {
+		prefix = 1;
+		argv++;	argc--;
+	}
+
+	while (argc >= 1) {
+		char *ret = strchr(*argv, '\n');
+		if (ret)
+			*ret = 0;
+		slash = strchr(*argv, '/');
+		if (slash)
+			*slash++ = 0;
+		if (!str2key(*argv, &x)) {
+			fprintf(stderr, "Ignoring invalid address '%s'\n", *argv);
+			argv++;
+			argc--;
+			continue;
+		}
+		node = calloc(1, sizeof(*node));
+		node->key = x;
+		if (prefix) {
+			node->node.pfx = slash ? atoi(slash) : 128;
+			eb128_insert_prefix(&e128, node);
+		}
+		else
+			eb128_insert(&e128, node);
+		argv++;
+		argc--;
+	}
+
+	printf("Dump of command line values :\n");
+	node = eb128_first(&e128);
+	while (node) {
+		printf("node %p = %s/%d\n", node, key2str(node->key), prefix ? node->node.pfx : 128);
+		node = eb128_next(node);
+	}
+
+	printf("Now enter lookup values, one per line.\n");
+	while (fgets(buffer, sizeof(buffer), stdin) != NULL) {
+		char *ret = strchr(buffer, '\n');
+		if (ret)
+			*ret = 0;
+		if (!str2key(buffer, &x)) {
+			printf("invalid address\n");
+			continue;
+		}
+		if (prefix) {
+			node =	eb128_lookup_longest(&e128, x);
+			printf("lm: node=%p, val=%s/%d\n", node, key2str(node?node->key:0), node?node->node.pfx:0);
+			continue;
+		}
+		node =	eb128_lookup(&e128, x);
+		printf("eq: node=%p, val=%s\n", node, key2str(node?node->key:0));
+		node =	eb128_lookup_le(&e128, x);
+		printf("le: node=%p, val=%s\n", node, key2str(node?node->key:0));
+		node =	eb128_lookup_ge(&e128, x);
+		printf("ge: node=%p, val=%s\n", node, key2str(node?node->key:0));
+	}
+	return 0;
+}
+
+#else /* !__SIZEOF_INT128__ */
+
+int main(void)
+{
+	fprintf(stderr, "128-bit integers are not supported on this platform.\n");
+	return 1;
+}
+
+#endif /* __SIZEOF_INT128__ */
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "ebcidr.h"
+
+/* Feeds each text below to an ebcidr set and compares the reduced set with
+ * the expected networks. Exits with non-zero if any of them differs.
+ */
+struct cidr_test {
+	const char *in;   /* networks, one per line */
+	const char *out;  /* expected networks, one per line, v4 then v6 */
+};
+
+static const struct cidr_test tests[] = {
+	{ "", "" },
+	{ "# nothing\n\n", "" },
+	{ "10.0.0.1\n", "10.0.0.1/32\n" },
+	{ "10.0.0.0/25\n10.0.0.128/25\n10.0.0.5\n", "10.0.0.0/24\n" },
+	{ "192.168.1.0/24\n10.0.0.0/8\n10.1.2.3\n", "10.0.0.0/8\n192.168.1.0/24\n" },
+	{ "2001:db8::/32\n", "2001:db8::/32\n" },
+	{ "2001:db8::/33\n2001:db8:8000::/33\n2001:db8::1\n", "2001:db8::/32\n" },
+	{ "2001:db8::/32\n10.0.0.0/8\n", "10.0.0.0/8\n2001:db8::/32\n" },
+};
+
+/* dumps set <set> as text into <out> of <size> bytes */
+static void dump(struct ebcidr *set, char *out, int size)
+{
+	struct ebmb_node *node;
+	char str[INET6_ADDRSTRLEN];
+	int len = 0;
+
+	*out = 0;
+	for (node = ebmb_first(&set->net4); node; node = ebmb_next(node))
+		len += snprintf(out + len, size - len, "%d.%d.%d.%d/%d\n",
+				node->key[0], node->key[1], node->key[2], node->key[3], node->node.pfx);
+
+	for (node = ebmb_first(&set->net6); node; node = ebmb_next(node)) {
+		inet_ntop(AF_INET6, node->key, str, sizeof(str));
+		len += snprintf(out + len, size - len, "%s/%d\n", str, node->node.pfx);
+	}
+}
+
+int main(void)
+{
+	struct ebcidr set;
+	char out[1024];
+	unsigned long bad;
+	unsigned int i;
+	int err = 0;
+
+	for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		if (!ebcidr_init(&set))
+			exit(1);
+		bad = 0;
+		ebcidr_add_text(&set, tests[i].in, strlen(tests[i].in), &bad);
+		if (!ebcidr_flush(&set))
+			exit(1);
+		dump(&set, out, sizeof(out));
+		if (bad || strcmp(out, tests[i].out) != 0) {
+			printf("test %u failed: got '%s', expected '%s'\n", i, out, tests[i].out);
+			err++;
+		}
+		ebcidr_destroy(&set);
+	}
+	printf("%u tests, %d failed\n", i, err);
+	return err != 0;
+}
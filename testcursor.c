@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ebmbtree.h"
+#include "ebsttree.h"
+#include "ebistree.h"
+
+/* Checks the prefix cursors of ebmb, ebst and ebis trees, with and without
+ * dups : the nodes returned with and without a limit must be the same as the
+ * first ones of a sorted brute-force list of the matching keys, including
+ * when each returned node is deleted while iterating. Exits with non-zero if
+ * anything is wrong.
+ */
+
+#define ROUNDS   3000
+#define KEYS     64
+#define WALKS    100
+#define MBLEN    4
+#define STLEN    6
+
+enum { MB = 0, ST, IS };
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static const unsigned char mbalpha[] = { 0x00, 0x61, 0x62, 0xff };
+static const char stalpha[] = "ab\x01\x7f\xff";
+
+struct item {
+	struct ebmb_node *mb;          /* node for ebmb and ebst trees */
+	struct ebpt_node pt;           /* node for ebis trees */
+	char str[STLEN + 1];           /* key of ebst and ebis nodes */
+	unsigned int seq;              /* insertion order, for dups */
+	int in;                        /* non-zero if in the tree */
+};
+
+static struct item items[KEYS];
+static struct eb_root root;
+static int kind, nitems;
+static unsigned int seq;
+
+/* compares the keys of items <a> and <b>, then their insertion order */
+static int cmp_items(const void *a, const void *b)
+{
+	const struct item *ia = *(const struct item **)a;
+	const struct item *ib = *(const struct item **)b;
+	int ret;
+
+	if (kind == MB)
+		ret = memcmp(ia->mb->key, ib->mb->key, MBLEN);
+	else
+		ret = strcmp(ia->str, ib->str);
+	if (ret)
+		return ret;
+	return ia->seq < ib->seq ? -1 : ia->seq > ib->seq;
+}
+
+/* returns non-zero if item <it> starts with the <len> bytes of <x> */
+static int match(const struct item *it, const char *x, int len)
+{
+	if (kind == MB)
+		return memcmp(it->mb->key, x, len) == 0;
+	return strncmp(it->str, x, len) == 0;
+}
+
+static void insert(struct item *it)
+{
+	if (kind == MB)
+		it->in = ebmb_insert(&root, it->mb, MBLEN) == it->mb;
+	else if (kind == ST)
+		it->in = ebst_insert(&root, it->mb) == it->mb;
+	else
+		it->in = ebis_insert(&root, &it->pt) == &it->pt;
+	it->seq = seq++;
+}
+
+static void delete(struct item *it)
+{
+	if (kind == IS)
+		ebpt_delete(&it->pt);
+	else
+		ebmb_delete(it->mb);
+	it->in = 0;
+}
+
+/* returns the item of node <node>, or NULL if none */
+static struct item *node_item(struct eb_node *node)
+{
+	int i;
+
+	for (i = 0; node && i < nitems; i++) {
+		if (kind == IS ? node == &items[i].pt.node : node == &items[i].mb->node)
+			return &items[i];
+	}
+	return NULL;
+}
+
+/* fills <exp> with the items in the tree starting with the <len> bytes of <x>,
+ * sorted, and returns their number.
+ */
+static int expected(struct item **exp, const char *x, int len)
+{
+	int i, n = 0;
+
+	for (i = 0; i < nitems; i++) {
+		if (items[i].in && match(&items[i], x, len))
+			exp[n++] = &items[i];
+	}
+	qsort(exp, n, sizeof(*exp), cmp_items);
+	return n;
+}
+
+int main(void)
+{
+	struct item *exp[KEYS];
+	struct eb_cursor cur;
+	struct eb_node *node;
+	char x[STLEN + 1];
+	unsigned long limit;
+	int round, walk, i, n, len, ret, del, got;
+	int err = 0, tot = 0;
+
+	for (i = 0; i < KEYS; i++)
+		items[i].mb = malloc(sizeof(*items[i].mb) + STLEN + 1);
+
+	for (round = 0; round < ROUNDS; round++) {
+		kind = round % 3;
+		root = (round / 3) & 1 ? (struct eb_root)EB_ROOT_UNIQUE : (struct eb_root)EB_ROOT;
+		nitems = 1 + rnd() % KEYS;
+		seq = 0;
+
+		for (i = 0; i < nitems; i++) {
+			struct item *it = &items[i];
+
+			if (kind == MB) {
+				for (len = 0; len < MBLEN; len++)
+					it->mb->key[len] = mbalpha[rnd() % sizeof(mbalpha)];
+			}
+			else {
+				len = rnd() % (STLEN + 1);
+				it->str[len] = 0;
+				while (len--)
+					it->str[len] = stalpha[rnd() % (sizeof(stalpha) - 1)];
+				strcpy((char *)it->mb->key, it->str);
+				it->pt.key = it->str;
+			}
+			insert(it);
+		}
+
+		for (walk = 0; walk < WALKS; walk++) {
+			/* look up a prefix of a random key, or a random one */
+			if (rnd() & 3) {
+				i = rnd() % nitems;
+				if (kind == MB) {
+					memcpy(x, items[i].mb->key, MBLEN);
+					len = rnd() % (MBLEN + 1);
+				}
+				else {
+					strcpy(x, items[i].str);
+					len = rnd() % (strlen(x) + 1);
+				}
+			}
+			else {
+				len = rnd() % (MBLEN + 1);
+				for (i = 0; i < len; i++)
+					x[i] = kind == MB ? mbalpha[rnd() % sizeof(mbalpha)] :
+						stalpha[rnd() % (sizeof(stalpha) - 1)];
+			}
+			x[len] = 0;
+
+			limit = rnd() & 1 ? 0 : 1 + rnd() % 8;
+			del = rnd() & 1;
+
+			n = expected(exp, x, len);
+			if (kind == MB)
+				ret = ebmb_prefix_cursor(&root, x, len, limit, &cur);
+			else if (kind == ST)
+				ret = ebst_prefix_cursor(&root, x, len, limit, &cur);
+			else
+				ret = ebis_prefix_cursor(&root, x, len, limit, &cur);
+			tot++;
+
+			if (!ret != !n)
+				err++;
+			if (limit && (unsigned long)n > limit)
+				n = limit;
+
+			got = 0;
+			while ((node = eb_cursor_next(&cur))) {
+				if (got >= n || node_item(node) != exp[got])
+					err++;
+				else if (del)
+					delete(exp[got]);
+				got++;
+			}
+			if (got != n)
+				err++;
+
+			/* put back what was deleted, they come last among dups */
+			for (i = 0; del && i < got && i < n; i++)
+				insert(exp[i]);
+		}
+
+		for (i = 0; i < nitems; i++) {
+			if (items[i].in)
+				delete(&items[i]);
+		}
+	}
+
+	printf("%d walks, %d errors\n", tot, err);
+	return err != 0;
+}
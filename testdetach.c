@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ebmbtree.h"
+#include "ebsttree.h"
+#include "ebistree.h"
+
+/* Checks ebmb_delete_prefix(), ebst_delete_prefix() and ebis_delete_prefix(),
+ * and thus eb_detach(), on random trees with and without dups : exactly the
+ * keys starting with the prefix must be passed once to the callback, already
+ * unlinked, and counted in the return value. The remaining tree must then
+ * hold all the other keys in order, walked forwards and backwards, and must
+ * still accept the deleted keys back and have them deleted one at a time.
+ * Exits with non-zero if anything is wrong.
+ */
+
+#define ROUNDS   3000
+#define KEYS     64
+#define PURGES   20
+#define MBLEN    4
+#define STLEN    6
+
+enum { MB = 0, ST, IS };
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static const unsigned char mbalpha[] = { 0x00, 0x61, 0x62, 0xff };
+static const char stalpha[] = "ab\x01\x7f\xff";
+
+struct item {
+	struct ebmb_node *mb;          /* node for ebmb and ebst trees */
+	struct ebpt_node pt;           /* node for ebis trees */
+	char str[STLEN + 1];           /* key of ebst and ebis nodes */
+	unsigned int seq;              /* insertion order, for dups */
+	int in;                        /* non-zero if in the tree */
+	int seen;                      /* number of calls to the callback */
+};
+
+static struct item items[KEYS];
+static struct eb_root root;
+static int kind, nitems, err;
+static unsigned int seq;
+
+/* compares the keys of items <a> and <b>, then their insertion order */
+static int cmp_items(const void *a, const void *b)
+{
+	const struct item *ia = *(const struct item **)a;
+	const struct item *ib = *(const struct item **)b;
+	int ret;
+
+	if (kind == MB)
+		ret = memcmp(ia->mb->key, ib->mb->key, MBLEN);
+	else
+		ret = strcmp(ia->str, ib->str);
+	if (ret)
+		return ret;
+	return ia->seq < ib->seq ? -1 : ia->seq > ib->seq;
+}
+
+/* returns non-zero if item <it> starts with the <len> bytes of <x> */
+static int match(const struct item *it, const char *x, int len)
+{
+	if (kind == MB)
+		return memcmp(it->mb->key, x, len) == 0;
+	return strncmp(it->str, x, len) == 0;
+}
+
+static void insert(struct item *it)
+{
+	if (kind == MB)
+		it->in = ebmb_insert(&root, it->mb, MBLEN) == it->mb;
+	else if (kind == ST)
+		it->in = ebst_insert(&root, it->mb) == it->mb;
+	else
+		it->in = ebis_insert(&root, &it->pt) == &it->pt;
+	it->seq = seq++;
+}
+
+static void delete(struct item *it)
+{
+	if (kind == IS)
+		ebpt_delete(&it->pt);
+	else
+		ebmb_delete(it->mb);
+	it->in = 0;
+}
+
+/* returns the item of node <node>, or NULL if none */
+static struct item *node_item(struct eb_node *node)
+{
+	int i;
+
+	for (i = 0; node && i < nitems; i++) {
+		if (kind == IS ? node == &items[i].pt.node : node == &items[i].mb->node)
+			return &items[i];
+	}
+	return NULL;
+}
+
+/* callback of the prefix deletes */
+static void purged(struct eb_node *node, void *arg)
+{
+	struct item *it = node_item(node);
+
+	(*(unsigned long *)arg)++;
+	if (!it || node->leaf_p)
+		err++;
+	else
+		it->seen++;
+}
+
+/* checks that the tree holds the items marked in it, in order, from both ends */
+static void check_tree(void)
+{
+	struct item *exp[KEYS];
+	struct eb_node *node;
+	int i, n = 0;
+
+	for (i = 0; i < nitems; i++) {
+		if (items[i].in)
+			exp[n++] = &items[i];
+	}
+	qsort(exp, n, sizeof(*exp), cmp_items);
+
+	for (i = 0, node = eb_first(&root); node; node = eb_next(node), i++) {
+		if (i >= n || node_item(node) != exp[i]) {
+			err++;
+			return;
+		}
+	}
+	err += i != n;
+
+	for (i = n, node = eb_last(&root); node; node = eb_prev(node)) {
+		if (--i < 0 || node_item(node) != exp[i]) {
+			err++;
+			return;
+		}
+	}
+	err += i != 0;
+}
+
+int main(void)
+{
+	struct item *gone[KEYS];
+	unsigned long ret, calls;
+	char x[STLEN + 1];
+	int round, purge, i, n, len;
+	int tot = 0;
+
+	for (i = 0; i < KEYS; i++)
+		items[i].mb = malloc(sizeof(*items[i].mb) + STLEN + 1);
+
+	for (round = 0; round < ROUNDS; round++) {
+		kind = round % 3;
+		root = (round / 3) & 1 ? (struct eb_root)EB_ROOT_UNIQUE : (struct eb_root)EB_ROOT;
+		nitems = 1 + rnd() % KEYS;
+		seq = 0;
+
+		for (i = 0; i < nitems; i++) {
+			struct item *it = &items[i];
+
+			if (kind == MB) {
+				for (len = 0; len < MBLEN; len++)
+					it->mb->key[len] = mbalpha[rnd() % sizeof(mbalpha)];
+			}
+			else {
+				len = rnd() % (STLEN + 1);
+				it->str[len] = 0;
+				while (len--)
+					it->str[len] = stalpha[rnd() % (sizeof(stalpha) - 1)];
+				strcpy((char *)it->mb->key, it->str);
+				it->pt.key = it->str;
+			}
+			insert(it);
+		}
+
+		for (purge = 0; purge < PURGES; purge++) {
+			/* purge a prefix of a random key, or a random one */
+			if (rnd() & 3) {
+				i = rnd() % nitems;
+				if (kind == MB) {
+					memcpy(x, items[i].mb->key, MBLEN);
+					len = rnd() % (MBLEN + 1);
+				}
+				else {
+					strcpy(x, items[i].str);
+					len = rnd() % (strlen(x) + 1);
+				}
+			}
+			else {
+				len = rnd() % (MBLEN + 1);
+				for (i = 0; i < len; i++)
+					x[i] = kind == MB ? mbalpha[rnd() % sizeof(mbalpha)] :
+						stalpha[rnd() % (sizeof(stalpha) - 1)];
+			}
+			x[len] = 0;
+
+			n = 0;
+			for (i = 0; i < nitems; i++) {
+				items[i].seen = 0;
+				if (items[i].in && match(&items[i], x, len))
+					gone[n++] = &items[i];
+			}
+
+			calls = 0;
+			if (kind == MB)
+				ret = ebmb_delete_prefix(&root, x, len, purged, &calls);
+			else if (kind == ST)
+				ret = ebst_delete_prefix(&root, x, len, purged, &calls);
+			else
+				ret = ebis_delete_prefix(&root, x, len, purged, &calls);
+			tot++;
+
+			if (ret != calls || ret != (unsigned long)n)
+				err++;
+			for (i = 0; i < nitems; i++) {
+				if (items[i].seen != (items[i].in && match(&items[i], x, len)))
+					err++;
+			}
+			for (i = 0; i < n; i++)
+				gone[i]->in = 0;
+			check_tree();
+
+			/* put the purged keys back, and sometimes delete them again */
+			for (i = 0; i < n; i++)
+				insert(gone[i]);
+			check_tree();
+			if (rnd() & 1) {
+				for (i = n; i > 0; i--) {
+					if (gone[i - 1]->in)
+						delete(gone[i - 1]);
+				}
+				check_tree();
+			}
+		}
+
+		for (i = 0; i < nitems; i++) {
+			if (items[i].in)
+				delete(&items[i]);
+		}
+		err += root.b[EB_LEFT] != NULL;
+	}
+
+	printf("%d purges, %d errors\n", tot, err);
+	return err != 0;
+}
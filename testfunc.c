@@ -2,9 +2,15 @@
  * ebtree performance test for various functions - willy tarreau - 2013
  *
  * Build for example with :
+ *   make testfunc CFLAGS="-O3 -DTYPE=eb16_node -DINSERT=__eb16_insert -DLOOKUP=__eb16_lookup -DDELETE=__eb16_delete -lm"
  *   make testfunc CFLAGS="-O3 -DTYPE=eb32_node -DINSERT=__eb32_insert -DLOOKUP=__eb32_lookup -DDELETE=__eb32_delete -lm"
  *   make testfunc CFLAGS="-O3 -DTYPE=eb64_node -DINSERT=__eb64_insert -DLOOKUP=__eb64_lookup -DDELETE=__eb64_delete -lm"
  *
+ * The branchless lookups may be tested using LOOKUP=__eb{32|64}_lookup_branchless.
+ *
+ * Usage: testfunc [nbnodes [rand|seq|zipf]]
+ * The last argument sets the order of lookups : random (default), ascending
+ * keys, or following a Zipf distribution (s=1) over the nodes.
  */
 
 #include <sys/time.h>
@@ -16,30 +22,66 @@
 #include <stdint.h>
 
 #include "ebtree.h"
+#include "eb16tree.h"
 #include "eb32tree.h"
 #include "eb64tree.h"
 
 #ifndef TYPE
-#error "Please define the node type to use with -DTYPE=eb{32|64}_node"
+#error "Please define the node type to use with -DTYPE=eb{16|32|64}_node"
 #endif
 
 #ifndef INSERT
-#error "Please define the insert function to use with -DINSERT=[__]eb{32|64}[i]_insert"
+#error "Please define the insert function to use with -DINSERT=[__]eb{16|32|64}[i]_insert"
 #endif
 
 #ifndef LOOKUP
-#error "Please define the lookup function to use with -DLOOKUP=[__]eb{32|64}[i]_lookup"
+#error "Please define the lookup function to use with -DLOOKUP=[__]eb{16|32|64}[i]_lookup"
 #endif
 
 #ifndef DELETE
-#error "Please define the delete function to use with -DDELETE=[__]eb{32|64}_delete"
+#error "Please define the delete function to use with -DDELETE=[__]eb{16|32|64}_delete"
 #endif
 
 
 struct eb_root root;
 struct TYPE *nodes;
+uint64_t *probes;
 int nbnodes;
 
+/* Fills probes[] with keys of the nodes in the order set by <mode> */
+static void prepare_probes(const char *mode)
+{
+	struct eb_node *node;
+	double *cdf, sum, r;
+	int i, lo, hi;
+
+	if (strcmp(mode, "seq") == 0) {
+		for (i = 0, node = eb_first(&root); node; node = eb_next(node))
+			probes[i++] = container_of(node, struct TYPE, node)->key;
+	}
+	else if (strcmp(mode, "zipf") == 0) {
+		/* rank i is node i, whose key is random anyway */
+		cdf = malloc(nbnodes * sizeof(*cdf));
+		for (sum = 0, i = 0; i < nbnodes; i++)
+			cdf[i] = (sum += 1.0 / (i + 1));
+		for (i = 0; i < nbnodes; i++) {
+			r = (double)random() / RAND_MAX * sum;
+			for (lo = 0, hi = nbnodes - 1; lo < hi; ) {
+				if (cdf[(lo + hi) / 2] < r)
+					lo = (lo + hi) / 2 + 1;
+				else
+					hi = (lo + hi) / 2;
+			}
+			probes[i] = nodes[lo].key;
+		}
+		free(cdf);
+	}
+	else {
+		for (i = 0; i < nbnodes; i++)
+			probes[i] = nodes[random() % nbnodes].key;
+	}
+}
+
 static inline unsigned long long rdtsc()
 {
      unsigned int a, d;
@@ -119,10 +161,12 @@ int main(int argc, char **argv)
 	       (double)last_insert / (nbnodes * (1 + log(nbnodes))));
 
 	/* look up all nodes */
+	probes = malloc(nbnodes * sizeof(*probes));
+	prepare_probes(argc > 2 ? argv[2] : "rand");
 	cal = rdtsc();
 	beg = rdtsc();
 	for (i = 0; i < nbnodes; i++) {
-		LOOKUP(&root, nodes[i].key);
+		LOOKUP(&root, probes[i]);
 	}
 	end = rdtsc();
 	tot_lookup = (end - beg) - (beg - cal);
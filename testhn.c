@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "ebhntree.h"
+
+/* Checks host name trees : invalid names are refused, the longest names fit
+ * in EBHN_KEY_SIZE() and are decoded back, and lookups of random names among
+ * random domains and wildcards return the same entry as a brute-force suffix
+ * match. Exits with non-zero if anything is wrong.
+ */
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/* names which must be refused */
+static const char *invalid[] = {
+	"", ".", "..", "....", "a..b", ".a", "a.b..", "*..a", "a.*..",
+};
+
+static const char *labels[] = { "a", "B", "ab", "c", "x*y" };
+
+/* writes a random name of 1 to 3 labels to <p>, starting with "*." if <wild> */
+static void make_name(char *p, int wild)
+{
+	int n = 1 + rnd() % 3;
+
+	*p = 0;
+	if (wild)
+		strcat(p, "*.");
+	while (n--) {
+		strcat(p, labels[rnd() % 5]);
+		if (n)
+			strcat(p, ".");
+	}
+}
+
+/* returns non-zero if entry <e> matches name <n> */
+static int match(const char *e, const char *n)
+{
+	int wild = strncmp(e, "*.", 2) == 0;
+	const char *d = wild ? e + 2 : e;
+	size_t ld = strlen(d), ln = strlen(n);
+
+	if (!wild && ln == ld && strcasecmp(n, d) == 0)
+		return 1;
+	return ln > ld && n[ln - ld - 1] == '.' && strcasecmp(n + ln - ld, d) == 0;
+}
+
+/* returns the number of labels of domain <e>, times 2, plus one if it is a
+ * wildcard, so that the most specific entry has the highest score.
+ */
+static int score(const char *e)
+{
+	int wild = *e == '*';
+	int n = 1;
+
+	for (; *e; e++)
+		n += *e == '.';
+	return (n - wild) * 2 + wild;
+}
+
+/* checks one name made of <n> labels of one char, returns non-zero if wrong */
+static int check_long(int n)
+{
+	char name[2 * EBHN_MAX_LEN], *key, back[2 * EBHN_MAX_LEN];
+	int len, i, ret;
+
+	for (len = i = 0; i < n; i++) {
+		if (i)
+			name[len++] = '.';
+		name[len++] = 'a' + i % 26;
+	}
+	name[len] = 0;
+
+	key = malloc(EBHN_KEY_SIZE(len));
+	if (!key)
+		exit(1);
+	ret = ebhn_encode(key, name, len);
+	if (len > EBHN_MAX_LEN) {
+		free(key);
+		return ret != -1;
+	}
+	if (ret < 0 || ret + 1 > EBHN_KEY_SIZE(len)) {
+		free(key);
+		return 1;
+	}
+	ebhn_decode(back, key);
+	free(key);
+	return strcmp(back, name) != 0;
+}
+
+int main(void)
+{
+	char key[EBHN_KEY_SIZE(EBHN_MAX_LEN)];
+	char dots[EBHN_MAX_LEN + 2];
+	char ents[20][32], name[128], dec[128];
+	struct eb_root root;
+	struct ebmb_node *node, *found;
+	unsigned int i;
+	int round, ne, j, best, bs, sc;
+	int err = 0;
+
+	for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		if (ebhn_encode(key, invalid[i], strlen(invalid[i])) != -1) {
+			printf("'%s' was not refused\n", invalid[i]);
+			err++;
+		}
+	}
+
+	/* the largest number of dots passing the length check */
+	memset(dots, '.', EBHN_MAX_LEN + 1);
+	dots[EBHN_MAX_LEN + 1] = 0;
+	root = (struct eb_root)EB_ROOT_UNIQUE;
+	if (ebhn_encode(key, dots, strlen(dots)) != -1 || ebhn_lookup_longest(&root, dots))
+		err++;
+
+	/* 127 labels make a name of EBHN_MAX_LEN chars, 128 are too many */
+	for (j = 1; j <= 128; j++) {
+		if (check_long(j)) {
+			printf("name of %d labels failed\n", j);
+			err++;
+		}
+	}
+
+	for (round = 0; round < 1000; round++) {
+		root = (struct eb_root)EB_ROOT_UNIQUE;
+		for (ne = j = 0; j < 20; j++) {
+			make_name(ents[ne], rnd() % 3 == 0);
+			node = malloc(sizeof(*node) + EBHN_KEY_SIZE(strlen(ents[ne])));
+			if (!node)
+				exit(1);
+			ebhn_encode((char *)node->key, ents[ne], strlen(ents[ne]));
+			if (ebhn_insert(&root, node) != node) {
+				free(node);
+				continue;
+			}
+			ebhn_decode(dec, (const char *)node->key);
+			if (strcasecmp(dec, ents[ne]) != 0)
+				err++;
+			ne++;
+		}
+
+		for (j = 0; j < 100; j++) {
+			make_name(name, 0);
+			if (rnd() & 1) {
+				/* a subdomain of it */
+				make_name(dec, 0);
+				strcat(dec, ".");
+				strcat(dec, name);
+				strcpy(name, dec);
+			}
+
+			best = -1;
+			bs = -1;
+			for (i = 0; i < (unsigned int)ne; i++) {
+				if (!match(ents[i], name))
+					continue;
+				sc = score(ents[i]);
+				if (sc > bs) {
+					bs = sc;
+					best = i;
+				}
+			}
+
+			found = ebhn_lookup_longest(&root, name);
+			if (best < 0) {
+				err += found != NULL;
+				continue;
+			}
+			if (!found) {
+				err++;
+				continue;
+			}
+			ebhn_decode(dec, (const char *)found->key);
+			if (strcasecmp(dec, ents[best]) != 0) {
+				printf("%s matched %s instead of %s\n", name, dec, ents[best]);
+				err++;
+			}
+		}
+
+		while ((node = ebmb_first(&root))) {
+			ebmb_delete(node);
+			free(node);
+		}
+	}
+
+	printf("%d errors\n", err);
+	return err != 0;
+}
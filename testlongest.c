@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ebsttree.h"
+#include "ebistree.h"
+
+/* Checks __ebst_lookup_longest() and __ebis_lookup_longest() against a
+ * brute-force search on random trees of strings with and without dups. Keys
+ * are mostly prefixes of a few base strings so that lookups have to pick the
+ * longest of many candidates. The inline versions are used so that building
+ * with -DEB_LONGEST_CANDS=<n> checks what happens once the candidate list is
+ * full. Exits with non-zero if anything is wrong.
+ */
+
+#define ROUNDS   2000
+#define KEYS     64
+#define LOOKUPS  200
+#define BASES    4
+#define KEYLEN   24
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static const char alpha[] = "/ab\x01\x7f\xff";
+
+/* writes a random string of up to <max> chars to <s> */
+static void make_rnd(char *s, int max)
+{
+	int l = rnd() % (max + 1);
+
+	while (l--)
+		*s++ = alpha[rnd() % (sizeof(alpha) - 1)];
+	*s = 0;
+}
+
+/* writes to <s> a random prefix of <base>, sometimes followed by random chars */
+static void make_key(char *s, const char *base)
+{
+	int l = rnd() % (strlen(base) + 1);
+
+	memcpy(s, base, l);
+	if (rnd() & 3)
+		s[l] = 0;
+	else
+		make_rnd(s + l, 3);
+}
+
+int main(void)
+{
+	struct ebmb_node *mb[KEYS];
+	struct ebpt_node *pt[KEYS];
+	char keys[KEYS][KEYLEN + 4];
+	char bases[BASES][KEYLEN + 1];
+	char x[KEYLEN + 8];
+	struct ebmb_node *a;
+	struct ebpt_node *b;
+	int in[KEYS];
+	int round, n, i, j, l, best, bl;
+	int err = 0, tot = 0;
+
+	for (i = 0; i < KEYS; i++) {
+		mb[i] = malloc(sizeof(*mb[i]) + KEYLEN + 4);
+		pt[i] = malloc(sizeof(*pt[i]));
+	}
+
+	for (round = 0; round < ROUNDS; round++) {
+		struct eb_root st = EB_ROOT;
+		struct eb_root is = EB_ROOT;
+
+		if (round & 1)
+			st = is = (struct eb_root)EB_ROOT_UNIQUE;
+
+		for (i = 0; i < BASES; i++) {
+			memset(bases[i], 0, sizeof(bases[i]));
+			for (j = 0; j < KEYLEN; j++)
+				bases[i][j] = alpha[rnd() % (sizeof(alpha) - 1)];
+		}
+
+		n = 1 + rnd() % KEYS;
+		for (i = 0; i < n; i++) {
+			make_key(keys[i], bases[rnd() % BASES]);
+			strcpy((char *)mb[i]->key, keys[i]);
+			in[i] = ebst_insert(&st, mb[i]) == mb[i];
+			pt[i]->key = keys[i];
+			ebis_insert(&is, pt[i]);
+		}
+
+		for (j = 0; j < LOOKUPS; j++) {
+			if (j & 1)
+				make_rnd(x, 8);
+			else {
+				strcpy(x, bases[rnd() % BASES]);
+				make_rnd(x + strlen(x), 3);
+			}
+
+			best = -1;
+			bl = -1;
+			for (i = 0; i < n; i++) {
+				l = strlen(keys[i]);
+				if (in[i] && l > bl && strncmp(keys[i], x, l) == 0) {
+					bl = l;
+					best = i;
+				}
+			}
+
+			a = __ebst_lookup_longest(&st, x);
+			b = __ebis_lookup_longest(&is, x);
+			tot++;
+			if (best < 0) {
+				err += (a != NULL) + (b != NULL);
+				continue;
+			}
+			/* the first occurrence of the key is expected on dups */
+			if (!a || a != ebst_lookup(&st, keys[best]))
+				err++;
+			if (!b || b != ebis_lookup(&is, keys[best]))
+				err++;
+		}
+
+		for (i = 0; i < n; i++) {
+			if (in[i])
+				ebmb_delete(mb[i]);
+			ebpt_delete(pt[i]);
+		}
+	}
+
+	printf("%d lookups, %d errors (%d candidates)\n", tot, err, EB_LONGEST_CANDS);
+	return err != 0;
+}
@@ -0,0 +1,168 @@
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "ebptlr.h"
+
+/* Stress check of ebptlr trees : objects are indexed by their address, a
+ * writer keeps deleting and re-inserting the odd ones while readers look up
+ * object addresses and addresses inside objects. Even objects are always
+ * present, so an exact lookup must find them, a lookup_le() on an address
+ * inside an object must return it or the even one before it, and a
+ * lookup_ge() the next one or the even one after it. No lookup may ever
+ * return an object with another key than expected. A timer also interrupts
+ * the writer with a signal whose handler performs the same lookups, since
+ * they must work from there too, even in the middle of a change, which is
+ * also the only way lookups meet a change on a single CPU. Exits with
+ * non-zero if any lookup went wrong. The number of lookups per reader may be passed as
+ * an argument, long runs on multiple CPUs being much more likely to catch a
+ * problem.
+ */
+
+#define NODES    4096
+#define READERS  3
+#define SIGLOOPS 16   /* lookups per signal */
+
+struct obj {
+	struct ebptlr_node node;
+	char area[64];
+};
+
+static struct obj objs[NODES];
+static struct ebptlr_root root = EBPTLR_ROOT_UNIQUE;
+static unsigned long errors[READERS + 1]; /* the last one for the signal handler */
+static unsigned long werrors;
+static volatile int stop;
+static int loops = 200000;
+
+static inline unsigned int rnd(unsigned int *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return *seed;
+}
+
+/* returns the index of the object of node <node>, or -1 if it is NULL */
+static inline int obj_idx(struct ebptlr_node *node)
+{
+	return node ? (struct obj *)ebptlr_key(node) - objs : -1;
+}
+
+/* The only writer, since writers must be serialized. Even objects are never
+ * touched. It is the only thread accepting the timer's signal.
+ */
+static void *writer(void *arg)
+{
+	unsigned int seed = 1;
+	struct obj *o;
+	sigset_t set;
+
+	(void)arg;
+	sigemptyset(&set);
+	sigaddset(&set, SIGALRM);
+	pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+	while (!stop) {
+		o = &objs[(rnd(&seed) % NODES) | 1];
+		ebptlr_delete(&root, &o->node);
+		if (ebptlr_insert(&root, &o->node, o) != &o->node)
+			werrors++;
+	}
+	return NULL;
+}
+
+/* Looks up a random object or address inside an object designated by <r>,
+ * and accounts for a wrong result in <errors[tid]>.
+ */
+static void check(long tid, unsigned int r)
+{
+	struct ebptlr_node *found;
+	int idx = r % NODES;
+	int f;
+
+	switch ((r >> 16) % 3) {
+	case 0:
+		found = ebptlr_lookup(&root, &objs[idx]);
+		f = obj_idx(found);
+		if (f != idx && (f >= 0 || !(idx & 1)))
+			errors[tid]++;
+		break;
+	case 1:
+		found = ebptlr_lookup_le(&root, &objs[idx].area[r % 64]);
+		f = obj_idx(found);
+		if (f != idx && (f != idx - 1 || !(idx & 1)))
+			errors[tid]++;
+		break;
+	default:
+		found = ebptlr_lookup_ge(&root, &objs[idx].area[r % 64]);
+		f = obj_idx(found);
+		if (idx + 1 == NODES) {
+			if (f >= 0)
+				errors[tid]++;
+		}
+		else if (f != idx + 1 && (idx & 1 || f != (idx + 2 < NODES ? idx + 2 : -1)))
+			errors[tid]++;
+		break;
+	}
+}
+
+/* Runs on the writer's thread, possibly in the middle of a change */
+static void sig_reader(int sig)
+{
+	static unsigned int seed = 5;
+	int i;
+
+	(void)sig;
+	for (i = 0; i < SIGLOOPS; i++)
+		check(READERS, rnd(&seed));
+}
+
+static void *reader(void *arg)
+{
+	long tid = (long)arg;
+	unsigned int seed = tid * 2246822519U + 7;
+	int i;
+
+	for (i = 0; i < loops; i++)
+		check(tid, rnd(&seed));
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t wthr, rthr[READERS];
+	struct itimerval timer = { { 0, 50 }, { 0, 50 } };
+	struct itimerval notimer = { { 0, 0 }, { 0, 0 } };
+	sigset_t set;
+	unsigned long err;
+	long i;
+
+	if (argc > 1)
+		loops = atoi(argv[1]);
+
+	for (i = 0; i < NODES; i++)
+		ebptlr_insert(&root, &objs[i].node, &objs[i]);
+
+	/* only the writer will unblock the signal */
+	sigemptyset(&set);
+	sigaddset(&set, SIGALRM);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+	signal(SIGALRM, sig_reader);
+	setitimer(ITIMER_REAL, &timer, NULL);
+
+	pthread_create(&wthr, NULL, writer, NULL);
+	for (i = 0; i < READERS; i++)
+		pthread_create(&rthr[i], NULL, reader, (void *)i);
+	for (i = 0; i < READERS; i++)
+		pthread_join(rthr[i], NULL);
+	setitimer(ITIMER_REAL, &notimer, NULL);
+	stop = 1;
+	pthread_join(wthr, NULL);
+
+	err = werrors;
+	for (i = 0; i <= READERS; i++)
+		err += errors[i];
+	printf("%d lookups, %lu failed\n", READERS * loops, err);
+	return err != 0;
+}
@@ -0,0 +1,123 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ebolc.h"
+
+/* Stress check of ebolc trees : writers keep deleting and re-inserting half
+ * of the nodes while readers look up keys which are always present, keys which
+ * come and go, and keys which are never present. Readers must always find the
+ * first ones, never find the last ones, and never return a node whose key
+ * differs from the probe. Few stripes are used so that readers and writers
+ * often meet. Exits with non-zero if any lookup went wrong. The number of
+ * lookups per reader may be passed as an argument, long runs on multiple CPUs
+ * being much more likely to catch a problem.
+ */
+
+#define KEYLEN   8
+#define NODES    4096
+#define WRITERS  2
+#define READERS  2
+
+struct tnode {
+	struct ebmb_node node;
+	unsigned char key[KEYLEN];
+};
+
+static struct tnode nodes[NODES];
+static struct ebolc_root root;
+static unsigned long errors[READERS];
+static volatile int stop;
+static int loops = 200000;
+
+static inline unsigned int rnd(unsigned int *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return *seed;
+}
+
+/* Writer <arg> owns the odd nodes of its slice, which it keeps deleting and
+ * re-inserting. Even nodes are never touched.
+ */
+static void *writer(void *arg)
+{
+	long tid = (long)arg;
+	unsigned int seed = tid * 2654435761U + 1;
+	struct tnode *n;
+	int slice = NODES / WRITERS;
+
+	while (!stop) {
+		n = &nodes[tid * slice + ((rnd(&seed) % slice) | 1)];
+		ebolc_delete(&root, &n->node);
+		ebolc_insert(&root, &n->node, KEYLEN);
+	}
+	return NULL;
+}
+
+static void *reader(void *arg)
+{
+	long tid = (long)arg;
+	unsigned int seed = tid * 2246822519U + 7;
+	unsigned char key[KEYLEN];
+	struct ebmb_node *found;
+	unsigned int r;
+	int i;
+
+	for (i = 0; i < loops; i++) {
+		r = rnd(&seed);
+		memcpy(key, nodes[r % NODES].key, KEYLEN);
+		if (r & 0x80000000)
+			key[KEYLEN - 1] |= 1; /* never present */
+		found = ebolc_lookup(&root, key, KEYLEN);
+		if (found && memcmp(found->key, key, KEYLEN) != 0)
+			errors[tid]++;
+		else if (key[KEYLEN - 1] & 1) {
+			if (found)
+				errors[tid]++;
+		}
+		else if (!found && !(r % NODES & 1))
+			errors[tid]++;
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t wthr[WRITERS], rthr[READERS];
+	unsigned int seed = 1, j;
+	unsigned long err = 0;
+	long i;
+
+	if (argc > 1)
+		loops = atoi(argv[1]);
+
+	if (!ebolc_init(&root, 2, 1))
+		exit(1);
+
+	/* present keys have their lowest bit cleared */
+	for (i = 0; i < NODES; i++) {
+		for (j = 0; j < KEYLEN; j++)
+			nodes[i].key[j] = rnd(&seed);
+		nodes[i].key[KEYLEN - 1] &= ~1;
+		if (ebolc_insert(&root, &nodes[i].node, KEYLEN) != &nodes[i].node)
+			i--;
+	}
+
+	for (i = 0; i < WRITERS; i++)
+		pthread_create(&wthr[i], NULL, writer, (void *)i);
+	for (i = 0; i < READERS; i++)
+		pthread_create(&rthr[i], NULL, reader, (void *)i);
+	for (i = 0; i < READERS; i++)
+		pthread_join(rthr[i], NULL);
+	stop = 1;
+	for (i = 0; i < WRITERS; i++)
+		pthread_join(wthr[i], NULL);
+
+	for (i = 0; i < READERS; i++)
+		err += errors[i];
+	printf("%d lookups, %lu failed\n", READERS * loops, err);
+	ebolc_destroy(&root);
+	return err != 0;
+}
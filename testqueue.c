@@ -0,0 +1,127 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "eb32queue.h"
+
+/* Stress check of eb32 queues : several producers keep posting insert and
+ * delete requests for their own nodes with random keys, while the owner
+ * applies them to the tree. Once all of them are done and applied, each node
+ * must be in the tree with the key of its last request if it was an insert,
+ * and out of it otherwise. A unique tree is then checked to report refused
+ * insertions. Exits with non-zero if anything is wrong.
+ */
+
+#define PRODUCERS  3
+#define NODES      1024                  /* per producer */
+#define REQUESTS   300000                /* per producer */
+#define QSIZE      256
+
+struct intent {
+	u32 key;
+	unsigned int op;
+};
+
+static struct eb32_node nodes[PRODUCERS][NODES];
+static struct intent last[PRODUCERS][NODES];
+static struct eb32_queue queue;
+static int running = PRODUCERS;
+
+static inline unsigned int rnd(unsigned int *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return *seed;
+}
+
+static void *producer(void *arg)
+{
+	long tid = (long)arg;
+	unsigned int seed = tid * 2654435761U + 1;
+	unsigned int r, n, op;
+	u32 key;
+	int i;
+
+	for (i = 0; i < REQUESTS; i++) {
+		r = rnd(&seed);
+		n = r % NODES;
+		op = (r >> 16) % 4 == 0 ? EB32_Q_DELETE : EB32_Q_INSERT;
+		key = rnd(&seed) % 5000;
+		while (!eb32_queue_push(&queue, &nodes[tid][n], key, op))
+			sched_yield();
+		last[tid][n].key = key;
+		last[tid][n].op = op;
+	}
+	__atomic_sub_fetch(&running, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void count_refused(struct eb32_node *node, void *arg)
+{
+	(void)node;
+	(*(int *)arg)++;
+}
+
+int main(void)
+{
+	struct eb_root root = EB_ROOT;
+	pthread_t thr[PRODUCERS];
+	struct eb32_node *node, uniq[3];
+	unsigned long inserted, intree;
+	int err = 0, refused = 0;
+	long i, j;
+
+	if (!eb32_queue_init(&queue, QSIZE))
+		exit(1);
+
+	for (i = 0; i < PRODUCERS; i++)
+		pthread_create(&thr[i], NULL, producer, (void *)i);
+
+	/* the owner applies requests until all producers are done */
+	while (1) {
+		if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+			while (eb32_queue_apply(&queue, &root, 0, NULL, NULL))
+				;
+			break;
+		}
+		if (!eb32_queue_apply(&queue, &root, 0, NULL, NULL))
+			sched_yield();
+	}
+	for (i = 0; i < PRODUCERS; i++)
+		pthread_join(thr[i], NULL);
+
+	inserted = 0;
+	for (i = 0; i < PRODUCERS; i++) {
+		for (j = 0; j < NODES; j++) {
+			node = &nodes[i][j];
+			if (last[i][j].op == EB32_Q_INSERT) {
+				inserted++;
+				if (!node->node.leaf_p || node->key != last[i][j].key)
+					err++;
+			}
+			else if (node->node.leaf_p)
+				err++;
+		}
+	}
+
+	intree = 0;
+	for (node = eb32_first(&root); node; node = eb32_next(node))
+		intree++;
+	if (intree != inserted)
+		err++;
+
+	/* refused insertions into a unique tree are reported */
+	root = (struct eb_root)EB_ROOT_UNIQUE;
+	for (i = 0; i < 3; i++) {
+		uniq[i].node.leaf_p = NULL;
+		eb32_queue_insert(&queue, &uniq[i], i == 2 ? 2 : 1);
+	}
+	eb32_queue_apply(&queue, &root, 0, count_refused, &refused);
+	if (refused != 1 || !uniq[0].node.leaf_p || uniq[1].node.leaf_p || !uniq[2].node.leaf_p)
+		err++;
+
+	printf("%lu nodes in the tree, %d errors\n", intree, err);
+	eb32_queue_destroy(&queue);
+	return err != 0;
+}
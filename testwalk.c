@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "eb32tree.h"
+#include "ebwalk.h"
+
+/* Checks that the ranges returned by eb_split() cover all the leaves of a
+ * tree exactly once and in order, and that eb_parallel_count(),
+ * eb_parallel_export() and eb_parallel_foreach() agree with a sequential walk
+ * for 1 to MAXTHR threads, on random eb32 trees with many dups or unique
+ * keys. Exits with non-zero if anything is wrong.
+ */
+
+#define ROUNDS   200
+#define NODES    3000
+#define MAXTHR   8
+
+struct tnode {
+	struct eb32_node node;
+	int range;              /* range number seen by eb_parallel_foreach() */
+	int visits;             /* number of calls from eb_parallel_foreach() */
+};
+
+static struct tnode nodes[NODES];
+static struct eb_node *seq[NODES];
+static struct eb_node *out[NODES];
+static struct eb_range ranges[EB_WALK_MAX_RANGES + 1];
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static int visit(struct eb_node *node, int range, void *arg)
+{
+	struct tnode *t = container_of(node, struct tnode, node.node);
+
+	(void)arg;
+	t->range = range;
+	__atomic_add_fetch(&t->visits, 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+/* checks that <nb> ranges <ranges> cover the <n> leaves of <seq> in order */
+static int check_ranges(const struct eb_range *ranges, int nb, int n)
+{
+	struct eb_node *node;
+	int i, pos = 0;
+
+	for (i = 0; i < nb; i++) {
+		for (node = ranges[i].first; node; node = eb_range_next(&ranges[i], node)) {
+			if (pos >= n || node != seq[pos])
+				return 1;
+			pos++;
+		}
+	}
+	return pos != n;
+}
+
+int main(void)
+{
+	struct eb_root root;
+	struct eb_node *node;
+	unsigned long ret;
+	int round, n, i, max, nb, thr, prev;
+	int err = 0, tot = 0;
+
+	for (round = 0; round < ROUNDS; round++) {
+		root = round & 1 ? (struct eb_root)EB_ROOT_UNIQUE : (struct eb_root)EB_ROOT;
+		n = round < 8 ? round / 2 : (int)(rnd() % NODES);
+		for (i = 0; i < n; ) {
+			/* few distinct keys on dup trees to get long dup chains */
+			nodes[i].node.key = round & 1 ? rnd() : rnd() % (1 + n / 8);
+			if (eb32_insert(&root, &nodes[i].node) == &nodes[i].node)
+				i++;
+		}
+
+		i = 0;
+		for (node = eb_first(&root); node; node = eb_next(node)) {
+			if (i >= n) {
+				err++;
+				break;
+			}
+			seq[i++] = node;
+		}
+		err += i != n;
+
+		/* all range counts, including more than supported */
+		err += eb_split(&root, ranges, 0) != 0;
+		for (max = 1; max <= EB_WALK_MAX_RANGES + 1; max = max < 64 ? max + 1 : max * 2 - 1) {
+			nb = eb_split(&root, ranges, max);
+			tot++;
+			if (nb < 0 || nb > max || nb > EB_WALK_MAX_RANGES || !nb != !n ||
+			    check_ranges(ranges, nb, n))
+				err++;
+		}
+
+		for (thr = 1; thr <= MAXTHR; thr++) {
+			ret = eb_parallel_count(&root, thr);
+			err += ret != (unsigned long)n;
+
+			for (i = 0; i < n; i++)
+				out[i] = NULL;
+			ret = eb_parallel_export(&root, thr, out, n);
+			err += ret != (unsigned long)n;
+			for (i = 0; i < n; i++)
+				err += out[i] != seq[i];
+
+			/* too small an output must be left untouched */
+			if (n) {
+				for (i = 0; i < n; i++)
+					out[i] = NULL;
+				ret = eb_parallel_export(&root, thr, out, n - 1);
+				err += ret != (unsigned long)n;
+				for (i = 0; i < n; i++)
+					err += out[i] != NULL;
+			}
+
+			for (i = 0; i < n; i++)
+				nodes[i].visits = 0;
+			nb = eb_parallel_foreach(&root, thr, visit, NULL);
+			err += !nb != !n;
+			/* each leaf once, range numbers ascending with keys */
+			prev = 0;
+			for (i = 0; i < n; i++) {
+				struct tnode *t = container_of(seq[i], struct tnode, node.node);
+
+				if (t->visits != 1 || t->range < prev || t->range >= nb)
+					err++;
+				prev = t->range;
+			}
+			tot += 3;
+		}
+
+		for (i = 0; i < n; i++)
+			eb32_delete(&nodes[i].node);
+	}
+
+	printf("%d walks, %d errors\n", tot, err);
+	return err != 0;
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ebmbtree.h"
+
+/* Checks that ebmb_insert_w() and ebmb_insert() may be mixed on one tree :
+ * the same random keys, with and without dups, are inserted in the same
+ * order into one tree using ebmb_insert() only and into another one randomly
+ * using either function, some being deleted and inserted again on the way.
+ * Both trees must have exactly the same shape and node bits, and both
+ * ebmb_lookup() and ebmb_lookup_w() must return the same node from them.
+ * Lengths which are not a multiple of 8 check the fallback to the byte
+ * functions. Exits with non-zero if anything is wrong.
+ */
+
+#define ROUNDS   400
+#define NODES    300
+#define LOOKUPS  500
+#define MAXLEN   64
+
+struct tnode {
+	struct ebmb_node node;
+	unsigned char key[MAXLEN];
+};
+
+static struct tnode byte_nodes[NODES], mixed_nodes[NODES];
+static struct eb_root byte_root, mixed_root;
+
+static const unsigned int lens[] = { 8, 16, 24, 64, 12, 1 };
+static const unsigned char alpha[] = { 0x00, 0x01, 0x80, 0xff };
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/* Returns the index of the node whose storage holds <ptr> in array <nodes>,
+ * -1 for root <root>, or -2 for NULL. Tags are returned in <tag>.
+ */
+static int ptr_idx(eb_troot_t *ptr, struct tnode *nodes, struct eb_root *root, int *tag)
+{
+	char *p = (char *)eb_clrtag(ptr);
+
+	*tag = eb_gettag(ptr);
+	if (!p)
+		return -2;
+	if (p == (char *)root)
+		return -1;
+	return (p - (char *)nodes) / sizeof(*nodes);
+}
+
+/* compares the shape of both trees, which hold the first <n> nodes */
+static int compare_trees(int n)
+{
+	struct ebmb_node *b, *m;
+	int i, err = 0;
+	int tb, tm;
+
+	for (i = 0; i < n; i++) {
+		b = &byte_nodes[i].node;
+		m = &mixed_nodes[i].node;
+		if (ptr_idx(b->node.leaf_p, byte_nodes, &byte_root, &tb) !=
+		    ptr_idx(m->node.leaf_p, mixed_nodes, &mixed_root, &tm) || tb != tm)
+			err++;
+		if (!b->node.leaf_p)
+			continue;
+		if (ptr_idx(b->node.node_p, byte_nodes, &byte_root, &tb) !=
+		    ptr_idx(m->node.node_p, mixed_nodes, &mixed_root, &tm) || tb != tm)
+			err++;
+		if (b->node.node_p && b->node.bit != m->node.bit)
+			err++;
+	}
+	return err;
+}
+
+/* returns the index of node <node> in array <nodes>, or -1 for NULL */
+static int node_idx(struct ebmb_node *node, struct tnode *nodes)
+{
+	return node ? (struct tnode *)node - nodes : -1;
+}
+
+int main(void)
+{
+	unsigned char x[MAXLEN];
+	unsigned int len;
+	int round, n, i, j, r1, r2;
+	int err = 0, tot = 0;
+
+	for (round = 0; round < ROUNDS; round++) {
+		len = lens[round % (sizeof(lens) / sizeof(lens[0]))];
+		byte_root = mixed_root = (round / 6) & 1 ?
+			(struct eb_root)EB_ROOT_UNIQUE : (struct eb_root)EB_ROOT;
+		n = 1 + rnd() % NODES;
+
+		for (i = 0; i < n; i++) {
+			/* repeat an earlier key from time to time to get dups */
+			if (i && !(rnd() & 3))
+				memcpy(byte_nodes[i].key, byte_nodes[rnd() % i].key, len);
+			else {
+				for (j = 0; j < (int)len; j++)
+					byte_nodes[i].key[j] = alpha[rnd() % sizeof(alpha)];
+			}
+			memcpy(mixed_nodes[i].key, byte_nodes[i].key, len);
+
+			r1 = node_idx(ebmb_insert(&byte_root, &byte_nodes[i].node, len), byte_nodes);
+			if (rnd() & 1)
+				r2 = node_idx(ebmb_insert_w(&mixed_root, &mixed_nodes[i].node, len), mixed_nodes);
+			else
+				r2 = node_idx(ebmb_insert(&mixed_root, &mixed_nodes[i].node, len), mixed_nodes);
+			err += r1 != r2;
+			if (r1 != i)
+				byte_nodes[i].node.node.leaf_p = mixed_nodes[i].node.node.leaf_p = NULL;
+
+			/* delete and insert again an earlier one */
+			if (!(rnd() & 7)) {
+				j = rnd() % (i + 1);
+				if (byte_nodes[j].node.node.leaf_p) {
+					ebmb_delete(&byte_nodes[j].node);
+					ebmb_delete(&mixed_nodes[j].node);
+					r1 = node_idx(ebmb_insert(&byte_root, &byte_nodes[j].node, len), byte_nodes);
+					r2 = node_idx(ebmb_insert_w(&mixed_root, &mixed_nodes[j].node, len), mixed_nodes);
+					err += r1 != r2;
+				}
+			}
+		}
+		err += compare_trees(n);
+
+		for (i = 0; i < LOOKUPS; i++) {
+			if (rnd() & 1)
+				memcpy(x, byte_nodes[rnd() % n].key, len);
+			else {
+				for (j = 0; j < (int)len; j++)
+					x[j] = alpha[rnd() % sizeof(alpha)];
+			}
+			r1 = node_idx(ebmb_lookup(&byte_root, x, len), byte_nodes);
+			err += r1 != node_idx(ebmb_lookup(&mixed_root, x, len), mixed_nodes);
+			err += r1 != node_idx(ebmb_lookup_w(&mixed_root, x, len), mixed_nodes);
+			err += r1 != node_idx(ebmb_lookup_w(&byte_root, x, len), byte_nodes);
+			tot++;
+		}
+
+		for (i = 0; i < n; i++) {
+			if (byte_nodes[i].node.node.leaf_p) {
+				ebmb_delete(&byte_nodes[i].node);
+				ebmb_delete(&mixed_nodes[i].node);
+			}
+		}
+	}
+
+	printf("%d lookups, %d errors\n", tot, err);
+	return err != 0;
+}